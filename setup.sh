@@ -4,6 +4,8 @@
 sudo apt update && sudo apt install -y cmake g++ wget unzip
 # Install deps for cvNamedWindow
 sudo apt install -y libgtk2.0-dev pkg-config
+# Install Google Benchmark for the optional preprocessing microbenchmarks
+sudo apt install -y libbenchmark-dev
 # Download and unpack sources for onnxruntime and opencv
 cd thirdparty
 wget https://github.com/microsoft/onnxruntime/releases/download/v1.13.1/onnxruntime-linux-x64-1.13.1.tgz && \
@@ -0,0 +1,98 @@
+#include "allocation_counter.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+static std::atomic<uint64_t> allocationCount{0};
+static std::atomic<uint64_t> exemptAllocationCount{0};
+
+uint64_t GetAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t GetExemptAllocationCount()
+{
+    return exemptAllocationCount.load(std::memory_order_relaxed);
+}
+
+static void CountAllocation()
+{
+    if (exemptAllocationScopes > 0)
+    {
+        exemptAllocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        CountAllocation();
+    }
+}
+
+extern "C"
+{
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void* __libc_valloc(size_t size);
+void* __libc_pvalloc(size_t size);
+
+void* malloc(size_t size) noexcept
+{
+    CountAllocation();
+
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept
+{
+    CountAllocation();
+
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept
+{
+    CountAllocation();
+
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept
+{
+    CountAllocation();
+
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+{
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+
+    *ptr = memalign(alignment, size);
+
+    return (*ptr != nullptr) ? 0 : ENOMEM;
+}
+
+void* valloc(size_t size) noexcept
+{
+    CountAllocation();
+
+    return __libc_valloc(size);
+}
+
+void* pvalloc(size_t size) noexcept
+{
+    CountAllocation();
+
+    return __libc_pvalloc(size);
+}
+}
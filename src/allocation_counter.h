@@ -0,0 +1,28 @@
+#ifndef ALLOCATION_COUNTER_H_
+#define ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+// Heap allocations of all threads, counted by interposing glibc's allocation functions in binaries that link
+// allocation_counter.cpp. This covers operator new, cv::Mat buffers (cv::fastMalloc), OpenCV scratch buffers
+// and allocations inside ONNX Runtime alike.
+uint64_t GetAllocationCount();
+// Allocations made inside ScopedExemptAllocations, which GetAllocationCount() leaves out
+uint64_t GetExemptAllocationCount();
+
+// Depth of the ScopedExemptAllocations of the current thread. Defined here, so that code linked into binaries without the
+// interposition can mark its exempt sections as well.
+inline thread_local int exemptAllocationScopes{0};
+
+// Marks allocations inside third party code (e.g. an image decoder) as beyond the control of the pipeline, like those
+// inside ONNX Runtime. They are counted separately instead of in GetAllocationCount().
+class ScopedExemptAllocations
+{
+    public:
+    ScopedExemptAllocations() { exemptAllocationScopes++; }
+    ScopedExemptAllocations(const ScopedExemptAllocations& other) = delete;
+    ScopedExemptAllocations& operator=(const ScopedExemptAllocations& other) = delete;
+    ~ScopedExemptAllocations() { exemptAllocationScopes--; }
+};
+
+#endif // #ifndef ALLOCATION_COUNTER_H_
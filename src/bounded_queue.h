@@ -0,0 +1,318 @@
+#ifndef BOUNDED_QUEUE_H_
+#define BOUNDED_QUEUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+enum class OverflowPolicy : uint8_t
+{
+    // Producer waits until a consumer made room
+    Block = 0,
+    // Oldest element is evicted to make room for the new one
+    DropOldest = 1,
+    // New element is rejected
+    DropNewest = 2
+};
+
+struct QueueStats
+{
+    uint64_t pushed;
+    uint64_t popped;
+    uint64_t dropped;
+    size_t occupancy;
+    size_t peakOccupancy;
+    size_t capacity;
+};
+
+// Multi-producer/multi-consumer ring buffer of fixed capacity. Push and pop are lock-free
+// (sequence numbered cells), a mutex is only taken to park threads that have to wait.
+template <typename T>
+class BoundedQueue
+{
+    public:
+    BoundedQueue(size_t capacity, OverflowPolicy policy) : cells_{std::make_unique<Cell[]>(capacity)}, capacity_{capacity}, policy_{policy}
+    {
+        for (size_t cellIdx = 0; cellIdx < capacity_; cellIdx++)
+        {
+            cells_[cellIdx].sequence.store(cellIdx, std::memory_order_relaxed);
+        }
+    }
+    BoundedQueue(const BoundedQueue& other) = delete;
+    BoundedQueue& operator=(const BoundedQueue& other) = delete;
+
+    // Pushes the value according to the overflow policy. Every element that does not make it into the queue, i.e. each
+    // evicted oldest element, the rejected value or the value itself if the queue was closed, is passed to onDropped.
+    // Returns whether the value was queued.
+    template <typename DropHandler>
+    bool push(T value, DropHandler&& onDropped)
+    {
+        while (!tryPush(value))
+        {
+            if (closed_.load(std::memory_order_acquire))
+            {
+                onDropped(std::move(value));
+
+                return false;
+            }
+
+            switch (policy_)
+            {
+                case OverflowPolicy::DropOldest:
+                {
+                    T oldestValue;
+
+                    if (tryPop(oldestValue))
+                    {
+                        dropped_.fetch_add(1, std::memory_order_relaxed);
+                        onDropped(std::move(oldestValue));
+                    }
+                    else
+                    {
+                        // Another thread is in the middle of handing over the cell
+                        std::this_thread::yield();
+                    }
+                    break;
+                }
+                case OverflowPolicy::DropNewest:
+                {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    onDropped(std::move(value));
+
+                    return false;
+                }
+                case OverflowPolicy::Block:
+                default:
+                {
+                    waitFor(notFullWaiters_, cvNotFull_, [this]() { return size() < capacity_; });
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Shorthand for Block and DropNewest queues, which drop at most the pushed value itself. Returns the dropped value.
+    // A push into a DropOldest queue may evict several elements, it has to pass a drop handler instead.
+    std::optional<T> push(T value)
+    {
+        assert(policy_ != OverflowPolicy::DropOldest);
+
+        std::optional<T> droppedValue;
+
+        (void)push(std::move(value), [&droppedValue](T&& dropped) { droppedValue = std::move(dropped); });
+
+        return droppedValue;
+    }
+
+    bool tryPop(T& value)
+    {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell& cell = cells_[pos % capacity_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0)
+            {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + capacity_, std::memory_order_release);
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        popped_.fetch_add(1, std::memory_order_relaxed);
+
+        wakeUp(notFullWaiters_, cvNotFull_);
+
+        return true;
+    }
+
+    // Blocks until an element is available. Returns false once the queue is closed and drained.
+    bool pop(T& value)
+    {
+        while (!tryPop(value))
+        {
+            if (closed_.load(std::memory_order_acquire) && size() == 0)
+            {
+                return false;
+            }
+
+            waitFor(notEmptyWaiters_, cvNotEmpty_, [this]() { return size() > 0; });
+        }
+
+        return true;
+    }
+
+    // Like pop(), but gives up at the deadline
+    template <typename Clock, typename Duration>
+    bool popUntil(T& value, const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        while (!tryPop(value))
+        {
+            if ((closed_.load(std::memory_order_acquire) && size() == 0) || Clock::now() >= deadline)
+            {
+                return false;
+            }
+
+            waitFor(notEmptyWaiters_, cvNotEmpty_, [this]() { return size() > 0; }, &deadline);
+        }
+
+        return true;
+    }
+
+    // Rejects further pushes and wakes up all waiting threads, remaining elements can still be popped
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lgWait{mtxWait_};
+            closed_.store(true, std::memory_order_release);
+        }
+
+        cvNotEmpty_.notify_all();
+        cvNotFull_.notify_all();
+    }
+
+    size_t size() const
+    {
+        const size_t enqueuePos = enqueuePos_.load(std::memory_order_acquire);
+        const size_t dequeuePos = dequeuePos_.load(std::memory_order_acquire);
+
+        return (enqueuePos > dequeuePos) ? (enqueuePos - dequeuePos) : 0;
+    }
+
+    QueueStats getStats() const
+    {
+        return QueueStats{pushed_.load(std::memory_order_relaxed), popped_.load(std::memory_order_relaxed), dropped_.load(std::memory_order_relaxed),
+                          size(), peakOccupancy_.load(std::memory_order_relaxed), capacity_};
+    }
+
+    private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    bool tryPush(T& value)
+    {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell& cell = cells_[pos % capacity_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+            if (diff == 0)
+            {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        pushed_.fetch_add(1, std::memory_order_relaxed);
+
+        const size_t occupancy = size();
+        size_t peakOccupancy = peakOccupancy_.load(std::memory_order_relaxed);
+
+        while (occupancy > peakOccupancy && !peakOccupancy_.compare_exchange_weak(peakOccupancy, occupancy, std::memory_order_relaxed))
+        {
+        }
+
+        wakeUp(notEmptyWaiters_, cvNotEmpty_);
+
+        return true;
+    }
+
+    // Waiters register themselves before re-checking the condition, and the fences order that against the
+    // producer/consumer publishing an element and checking for waiters, hence no wake-up can be lost
+    template <typename Predicate, typename TimePoint = std::chrono::steady_clock::time_point>
+    void waitFor(std::atomic<int>& waiters, std::condition_variable& cv, Predicate predicate, const TimePoint* deadline = nullptr)
+    {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        {
+            std::unique_lock<std::mutex> ulWait{mtxWait_};
+
+            auto wakeUpPredicate = [&]() { return predicate() || closed_.load(std::memory_order_acquire); };
+
+            if (deadline != nullptr)
+            {
+                cv.wait_until(ulWait, *deadline, wakeUpPredicate);
+            }
+            else
+            {
+                cv.wait(ulWait, wakeUpPredicate);
+            }
+        }
+
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void wakeUp(std::atomic<int>& waiters, std::condition_variable& cv)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (waiters.load(std::memory_order_relaxed) > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lgWait{mtxWait_};
+            }
+
+            cv.notify_all();
+        }
+    }
+
+    std::unique_ptr<Cell[]> cells_;
+    const size_t capacity_;
+    const OverflowPolicy policy_;
+    alignas(64) std::atomic<size_t> enqueuePos_{0};
+    alignas(64) std::atomic<size_t> dequeuePos_{0};
+    alignas(64) std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> popped_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<size_t> peakOccupancy_{0};
+    std::atomic<bool> closed_{false};
+    std::atomic<int> notEmptyWaiters_{0};
+    std::atomic<int> notFullWaiters_{0};
+    std::mutex mtxWait_;
+    std::condition_variable cvNotEmpty_;
+    std::condition_variable cvNotFull_;
+};
+
+#endif // #ifndef BOUNDED_QUEUE_H_
\ No newline at end of file
@@ -0,0 +1,480 @@
+#include "config.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+static void PrintUsage(const char* const programName)
+{
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "  --max-batch-size <N>        Maximum number of images per inference call (default: 8)\n"
+              << "  --max-batch-delay-us <T>    Maximum time in microseconds to wait for a batch to fill up (default: 2000)\n"
+              << "  --workers <N>               Number of inference workers, each owning a session per model (default: 1)\n"
+              << "  --intra-op-threads <N>      Threads of the intra-op pool shared by all sessions, 0 uses all hardware threads (default: 0)\n"
+              << "  --pipeline-depth <N>        Batches in flight per worker and model across preprocessing, inference and postprocessing (default: 3)\n"
+              << "  --models <LIST>             Comma separated models served side by side: mobilenetv2, mobilenetv2-int8 (default: selected by --precision)\n"
+              << "  --input-queue-capacity <N>  Capacity of the captured image queue of each model (default: 32)\n"
+              << "  --input-queue-policy <P>    Overflow policy of the captured image queue: block, drop-oldest or drop-newest (default: block)\n"
+              << "  --capture-interval-ms <T>   Shortest interval between captured frames, longer while inference falls behind (default: 500)\n"
+              << "  --latency-slo-ms <T>        Drop frames before preprocessing that cannot be classified within T ms of capture, 0 disables (default: 0)\n"
+              << "  --display-fps <N>           Maximum display refresh rate, intermediate results are skipped (default: 30)\n"
+              << "  --decode-threads <N>        Threads decoding images ahead of capturing, 0 decodes on the capture thread (default: 0)\n"
+              << "  --read-ahead <N>            Number of images decoded ahead of capturing (default: 0)\n"
+              << "  --reduced-decode            Decode JPEGs at the smallest reduced resolution covering the model input\n"
+              << "  --images <DIR>              Directory the images are read from (default: assets/images/)\n"
+              << "  --pack <FILE>               Stream images from a packed dataset created by Icarus_pack instead of the images directory\n"
+              << "  --video <FILE>              Stream the frames of a video file instead of still images, looping at its end\n"
+              << "  --max-frame-age-ms <T>      Drop video frames older than T milliseconds when inference falls behind, 0 keeps all (default: 0)\n"
+              << "  --model-cache <DIR>         Cache the optimized models in DIR and load them from there on later starts (default: disabled)\n"
+              << "  --warmup-runs <N>           Blank inferences per session before frames are accepted (default: 1)\n"
+              << "  --tensor-cache-mb <N>       Memory budget of the preprocessed tensor cache in MiB, 0 disables it (default: 0)\n"
+              << "  --result-cache <MODE>       Reuse the predictions of frames seen before: off, exact or perceptual (default: off)\n"
+              << "  --result-cache-entries <N>  Predictions kept by the result cache (default: 1024)\n"
+              << "  --result-cache-distance <B> Differing bits of the difference hashes still treated as the same frame in perceptual mode (default: 4)\n"
+              << "  --preprocess <MODE>         Preprocessing implementation: reference, fused, static or in-graph (default: reference)\n"
+              << "  --precision <P>             Model variant: fp32 or int8 (default: fp32)\n"
+              << "  --top-k <N>                 Number of most probable classes reported per image (default: 5, at most 10)\n"
+              << "  --verify-preprocess         Debugging aid, report the deviation of the fused preprocessing from the reference per frame\n"
+              << "  --metrics-file <FILE>       Periodically write stage latency histograms to FILE in Prometheus text format\n"
+              << "  --metrics-interval-ms <T>   Interval of the metrics export in milliseconds (default: 5000)\n"
+              << "  --pin-capture <CPUS>        Pin the capture and decoding threads to CPUS, a cpulist (0-3,8) or node:N for the CPUs of a NUMA node\n"
+              << "  --pin-preprocess <CPUS>     Pin the preprocessing threads, semicolon separated lists are assigned to the workers in turn\n"
+              << "  --pin-inference <CPUS>      Pin the inference threads and allocate their sessions and buffers locally, one list per worker as above\n"
+              << "  --pin-postprocess <CPUS>    Pin the postprocessing threads, one list per worker as above\n"
+              << "  --pin-display <CPUS>        Pin the display thread\n"
+              << "  --pin-onnxruntime <CPUS>    Pin the ONNX Runtime pool threads, one CPU per thread\n"
+              << "  --config <FILE>             Read options from FILE, one \"option = value\" per line without the leading dashes, # starts a comment\n"
+              << "  --help                      Print this message\n";
+}
+
+static long long ParseInteger(const std::string& option, const char* const value, long long minValue)
+{
+    char* end = nullptr;
+    long long parsedValue = std::strtoll(value, &end, 10);
+
+    if (end == value || *end != '\0' || parsedValue < minValue)
+    {
+        std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return parsedValue;
+}
+
+static PreprocessMode ParsePreprocessMode(const std::string& value)
+{
+    if (value == "reference")
+    {
+        return PreprocessMode::Reference;
+    }
+    else if (value == "fused")
+    {
+        return PreprocessMode::Fused;
+    }
+    else if (value == "static")
+    {
+        return PreprocessMode::Static;
+    }
+    else if (value == "in-graph")
+    {
+        return PreprocessMode::InGraph;
+    }
+
+    std::cerr << "Invalid value for --preprocess: " << value << std::endl;
+
+    std::exit(EXIT_FAILURE);
+}
+
+static ResultCacheMode ParseResultCacheMode(const std::string& value)
+{
+    if (value == "off")
+    {
+        return ResultCacheMode::Disabled;
+    }
+    else if (value == "exact")
+    {
+        return ResultCacheMode::Exact;
+    }
+    else if (value == "perceptual")
+    {
+        return ResultCacheMode::Perceptual;
+    }
+
+    std::cerr << "Invalid value for --result-cache: " << value << std::endl;
+
+    std::exit(EXIT_FAILURE);
+}
+
+static ModelPrecision ParseModelPrecision(const std::string& value)
+{
+    if (value == "fp32")
+    {
+        return ModelPrecision::FP32;
+    }
+    else if (value == "int8")
+    {
+        return ModelPrecision::INT8;
+    }
+
+    std::cerr << "Invalid value for --precision: " << value << std::endl;
+
+    std::exit(EXIT_FAILURE);
+}
+
+static std::vector<std::string> ParseList(const std::string& option, const std::string& value)
+{
+    std::vector<std::string> items;
+
+    for (size_t itemStart = 0; itemStart <= value.size();)
+    {
+        size_t itemEnd = value.find(',', itemStart);
+
+        if (itemEnd == std::string::npos)
+        {
+            itemEnd = value.size();
+        }
+
+        if (itemEnd == itemStart)
+        {
+            std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        items.push_back(value.substr(itemStart, itemEnd - itemStart));
+        itemStart = itemEnd + 1;
+    }
+
+    return items;
+}
+
+static OverflowPolicy ParseOverflowPolicy(const std::string& option, const std::string& value)
+{
+    if (value == "block")
+    {
+        return OverflowPolicy::Block;
+    }
+    else if (value == "drop-oldest")
+    {
+        return OverflowPolicy::DropOldest;
+    }
+    else if (value == "drop-newest")
+    {
+        return OverflowPolicy::DropNewest;
+    }
+
+    std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+    std::exit(EXIT_FAILURE);
+}
+
+static CpuList ParseCpuListOption(const std::string& option, const std::string& value)
+{
+    std::optional<CpuList> cpus = ParseCpuList(value);
+
+    if (!cpus.has_value())
+    {
+        std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return *cpus;
+}
+
+// One CPU list per worker, separated by semicolons
+static std::vector<CpuList> ParseWorkerCpuLists(const std::string& option, const std::string& value)
+{
+    std::vector<CpuList> workerCpuLists;
+
+    for (size_t listStart = 0; listStart <= value.size();)
+    {
+        size_t listEnd = value.find(';', listStart);
+
+        if (listEnd == std::string::npos)
+        {
+            listEnd = value.size();
+        }
+
+        workerCpuLists.push_back(ParseCpuListOption(option, value.substr(listStart, listEnd - listStart)));
+        listStart = listEnd + 1;
+    }
+
+    return workerCpuLists;
+}
+
+static std::string Trim(const std::string& str)
+{
+    const size_t first = str.find_first_not_of(" \t\r");
+
+    if (first == std::string::npos)
+    {
+        return std::string{};
+    }
+
+    return str.substr(first, str.find_last_not_of(" \t\r") - first + 1);
+}
+
+// Translates the lines of a config file into command line arguments: "option = value" into --option value, "flag" into --flag
+static void ReadConfigFile(const std::string& configPath, std::vector<std::string>& args)
+{
+    std::ifstream ifstrm{configPath};
+
+    if (!ifstrm.is_open())
+    {
+        std::cerr << "Could not open config file: " << configPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::string line;
+
+    while (std::getline(ifstrm, line))
+    {
+        line = Trim(line.substr(0, line.find('#')));
+
+        if (line.empty())
+        {
+            continue;
+        }
+
+        const size_t separatorPos = line.find('=');
+
+        args.push_back("--" + Trim(line.substr(0, separatorPos)));
+
+        if (separatorPos != std::string::npos)
+        {
+            args.push_back(Trim(line.substr(separatorPos + 1)));
+        }
+    }
+}
+
+Config ParseCommandLine(int argc, char* argv[])
+{
+    Config config;
+
+    std::vector<std::string> args;
+
+    for (int argIdx = 1; argIdx + 1 < argc; argIdx++)
+    {
+        if (std::string{argv[argIdx]} == "--config")
+        {
+            ReadConfigFile(argv[argIdx + 1], args);
+        }
+    }
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        args.emplace_back(argv[argIdx]);
+    }
+
+    for (size_t argIdx = 0; argIdx < args.size(); argIdx++)
+    {
+        const std::string& option = args[argIdx];
+
+        if (option == "--help")
+        {
+            PrintUsage(argv[0]);
+
+            std::exit(EXIT_SUCCESS);
+        }
+        else if (option == "--verify-preprocess")
+        {
+            config.verifyPreprocess = true;
+            continue;
+        }
+        else if (option == "--reduced-decode")
+        {
+            config.reducedDecode = true;
+            continue;
+        }
+
+        if (argIdx + 1 >= args.size())
+        {
+            std::cerr << "Missing value for option: " << option << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        const char* const value = args[++argIdx].c_str();
+
+        if (option == "--config")
+        {
+            // Read ahead of the other options
+        }
+        else if (option == "--max-batch-size")
+        {
+            config.maxBatchSize = ParseInteger(option, value, 1);
+        }
+        else if (option == "--max-batch-delay-us")
+        {
+            config.maxBatchDelay = std::chrono::microseconds{ParseInteger(option, value, 0)};
+        }
+        else if (option == "--workers")
+        {
+            config.nrOfWorkers = ParseInteger(option, value, 1);
+        }
+        else if (option == "--intra-op-threads")
+        {
+            config.intraOpThreads = ParseInteger(option, value, 0);
+        }
+        else if (option == "--pipeline-depth")
+        {
+            config.pipelineDepth = ParseInteger(option, value, 1);
+        }
+        else if (option == "--models")
+        {
+            config.modelNames = ParseList(option, value);
+        }
+        else if (option == "--input-queue-capacity")
+        {
+            config.inputQueueCapacity = ParseInteger(option, value, 1);
+        }
+        else if (option == "--input-queue-policy")
+        {
+            config.inputQueuePolicy = ParseOverflowPolicy(option, value);
+        }
+        else if (option == "--capture-interval-ms")
+        {
+            config.minCaptureInterval = std::chrono::milliseconds{ParseInteger(option, value, 0)};
+        }
+        else if (option == "--latency-slo-ms")
+        {
+            config.latencySlo = std::chrono::milliseconds{ParseInteger(option, value, 0)};
+        }
+        else if (option == "--display-fps")
+        {
+            config.maxDisplayFps = static_cast<double>(ParseInteger(option, value, 1));
+        }
+        else if (option == "--decode-threads")
+        {
+            config.decodeThreads = ParseInteger(option, value, 0);
+        }
+        else if (option == "--read-ahead")
+        {
+            config.readAheadDepth = ParseInteger(option, value, 0);
+        }
+        else if (option == "--images")
+        {
+            config.imagesPath = value;
+        }
+        else if (option == "--pack")
+        {
+            config.packPath = value;
+        }
+        else if (option == "--video")
+        {
+            config.videoPath = value;
+        }
+        else if (option == "--max-frame-age-ms")
+        {
+            config.maxFrameAge = std::chrono::milliseconds{ParseInteger(option, value, 0)};
+        }
+        else if (option == "--model-cache")
+        {
+            config.modelCacheDir = value;
+        }
+        else if (option == "--warmup-runs")
+        {
+            config.warmupRuns = ParseInteger(option, value, 0);
+        }
+        else if (option == "--tensor-cache-mb")
+        {
+            config.tensorCacheBudgetMB = ParseInteger(option, value, 0);
+        }
+        else if (option == "--result-cache")
+        {
+            config.resultCacheMode = ParseResultCacheMode(value);
+        }
+        else if (option == "--result-cache-entries")
+        {
+            config.resultCacheEntries = ParseInteger(option, value, 1);
+        }
+        else if (option == "--result-cache-distance")
+        {
+            config.resultCacheDistance = static_cast<uint32_t>(ParseInteger(option, value, 0));
+        }
+        else if (option == "--preprocess")
+        {
+            config.preprocessMode = ParsePreprocessMode(value);
+        }
+        else if (option == "--precision")
+        {
+            config.modelPrecision = ParseModelPrecision(value);
+        }
+        else if (option == "--top-k")
+        {
+            config.topK = ParseInteger(option, value, 1);
+
+            if (config.topK > Prediction::kMaxTopK)
+            {
+                std::cerr << "Invalid value for " << option << ": " << value << ", at most " << Prediction::kMaxTopK << " classes are supported" << std::endl;
+
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        else if (option == "--metrics-file")
+        {
+            config.metricsFilePath = value;
+        }
+        else if (option == "--metrics-interval-ms")
+        {
+            config.metricsExportInterval = std::chrono::milliseconds{ParseInteger(option, value, 1)};
+        }
+        else if (option == "--pin-capture")
+        {
+            config.placement.capture = ParseCpuListOption(option, value);
+        }
+        else if (option == "--pin-preprocess")
+        {
+            config.placement.preprocess = ParseWorkerCpuLists(option, value);
+        }
+        else if (option == "--pin-inference")
+        {
+            config.placement.inference = ParseWorkerCpuLists(option, value);
+        }
+        else if (option == "--pin-postprocess")
+        {
+            config.placement.postprocess = ParseWorkerCpuLists(option, value);
+        }
+        else if (option == "--pin-display")
+        {
+            config.placement.display = ParseCpuListOption(option, value);
+        }
+        else if (option == "--pin-onnxruntime")
+        {
+            config.placement.onnxRuntime = ParseCpuListOption(option, value);
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            PrintUsage(argv[0]);
+
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!config.videoPath.empty() && !config.packPath.empty())
+    {
+        std::cerr << "Options --video and --pack are mutually exclusive" << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Video frames share the path of their file, which the tensor cache relies on to tell images apart
+    if (!config.videoPath.empty() && config.tensorCacheBudgetMB > 0)
+    {
+        std::cerr << "The tensor cache is not supported for video input" << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (config.modelNames.empty())
+    {
+        config.modelNames.push_back((config.modelPrecision == ModelPrecision::INT8) ? "mobilenetv2-int8" : "mobilenetv2");
+    }
+
+    return config;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include "image_preprocessor.h"
+#include "model_handler.h"
+#include "bounded_queue.h"
+#include "result_cache.h"
+#include "thread_placement.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// CPUs the threads of the pipeline stages are pinned to, empty lists leave them to the scheduler. The worker stages take
+// one list per worker (see SelectCpuList), so that workers can be placed on NUMA nodes of their own.
+struct StagePlacement
+{
+    // Capture thread and the decoding threads of the image provider, which also allocate the frame pool
+    CpuList capture;
+    std::vector<CpuList> preprocess;
+    // Inference threads, whose runtime slots and sessions are allocated while pinned as well
+    std::vector<CpuList> inference;
+    std::vector<CpuList> postprocess;
+    CpuList display;
+    // Intra-op and inter-op pool threads of ONNX Runtime, one CPU per thread
+    CpuList onnxRuntime;
+};
+
+struct Config
+{
+    // Upper bound of images packed into a single session call
+    int64_t maxBatchSize{8};
+    // Maximum time the batcher waits for a batch to fill up once its first image arrived
+    std::chrono::microseconds maxBatchDelay{2000};
+    // Number of inference workers, each owning a session per model, its runtime slots and its stage threads
+    int64_t nrOfWorkers{1};
+    // Threads of the intra-op pool shared by all sessions, 0 uses all hardware threads
+    int64_t intraOpThreads{0};
+    // Runtime slots per worker and model, batches in flight through its preprocessing, inference and postprocessing stages
+    size_t pipelineDepth{3};
+    // Registered models served side by side, captured images are routed to them in turn. Defaults to the model selected by modelPrecision.
+    std::vector<std::string> modelNames;
+    // Captured images waiting for inference per model, blocking applies backpressure to the capture stage
+    size_t inputQueueCapacity{32};
+    OverflowPolicy inputQueuePolicy{OverflowPolicy::Block};
+    // Shortest interval between captured frames. Capturing slows down further while the measured inference time per frame
+    // (spread over the workers) exceeds it.
+    std::chrono::milliseconds minCaptureInterval{500};
+    // End-to-end latency objective of a frame, frames that cannot be classified in time are dropped before preprocessing. 0 disables deadlines.
+    std::chrono::milliseconds latencySlo{0};
+    // Upper bound of the display refresh rate, results arriving faster replace each other
+    double maxDisplayFps{30.0};
+    // Image decoding ahead of the capture thread, see ImageProviderOptions
+    size_t decodeThreads{0};
+    size_t readAheadDepth{0};
+    // Decode JPEGs at a reduced resolution that still covers the model input size
+    bool reducedDecode{false};
+    // Directory of still images, used if neither a packed dataset nor a video is given
+    std::string imagesPath{"assets/images/"};
+    // Packed dataset (see Icarus_pack) streamed instead of the images directory, empty reads the directory
+    std::string packPath;
+    // Video file streamed instead of still images, with frames older than maxFrameAge dropped (0 keeps all)
+    std::string videoPath;
+    std::chrono::milliseconds maxFrameAge{0};
+    // Directory of the optimized model cache, empty optimizes the models on every start
+    std::string modelCacheDir;
+    // Blank inferences per session before frames are accepted
+    size_t warmupRuns{1};
+    // Memory budget of the preprocessed tensor cache, 0 disables caching
+    size_t tensorCacheBudgetMB{0};
+    // Predictions of frames seen before are reused instead of classifying them again, matched by pixels or by their difference hash
+    ResultCacheMode resultCacheMode{ResultCacheMode::Disabled};
+    size_t resultCacheEntries{1024};
+    // Largest Hamming distance of the difference hashes of frames sharing a prediction in perceptual mode
+    uint32_t resultCacheDistance{4};
+    PreprocessMode preprocessMode{PreprocessMode::Reference};
+    ModelPrecision modelPrecision{ModelPrecision::FP32};
+    // Number of most probable classes reported per image
+    size_t topK{5};
+    // Compare the fused preprocessing kernel against the transformation chain on every frame
+    bool verifyPreprocess{false};
+    // Stage latency histograms are periodically written to this file in Prometheus text format, empty disables the export
+    std::string metricsFilePath;
+    std::chrono::milliseconds metricsExportInterval{5000};
+    StagePlacement placement;
+};
+
+// Options given in a file (--config) are applied before the ones on the command line, which thus take precedence
+Config ParseCommandLine(int argc, char* argv[]);
+
+#endif // #ifndef CONFIG_H_
\ No newline at end of file
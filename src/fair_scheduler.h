@@ -0,0 +1,154 @@
+#ifndef FAIR_SCHEDULER_H_
+#define FAIR_SCHEDULER_H_
+
+#include "bounded_queue.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// One bounded queue per model, served in round-robin order: consumers take their next batch from the queue
+// following the one the previous batch was taken from, so that a model flooded with requests cannot starve the others.
+template <typename T>
+class FairScheduler
+{
+    public:
+    FairScheduler(size_t nrOfQueues, size_t queueCapacity, OverflowPolicy policy)
+    {
+        for (size_t queueIdx = 0; queueIdx < nrOfQueues; queueIdx++)
+        {
+            queues_.push_back(std::make_unique<BoundedQueue<T>>(queueCapacity, policy));
+        }
+    }
+    FairScheduler(const FairScheduler& other) = delete;
+    FairScheduler& operator=(const FairScheduler& other) = delete;
+
+    // Same semantics as BoundedQueue::push() on the queue of the given model
+    template <typename DropHandler>
+    bool push(size_t queueIdx, T value, DropHandler&& onDropped)
+    {
+        const bool queued = queues_[queueIdx]->push(std::move(value), std::forward<DropHandler>(onDropped));
+
+        // Taking the mutex orders the push before a consumer that found all queues empty starts waiting
+        {
+            std::lock_guard<std::mutex> lock{mtx_};
+        }
+        cvAvailable_.notify_one();
+
+        return queued;
+    }
+
+    // Shorthand for Block and DropNewest queues, see BoundedQueue::push()
+    std::optional<T> push(size_t queueIdx, T value)
+    {
+        std::optional<T> dropped;
+
+        (void)push(queueIdx, std::move(value), [&dropped](T&& droppedValue) { dropped = std::move(droppedValue); });
+
+        return dropped;
+    }
+
+    // Blocks until any queue holds a value, then collects a batch from the next non-empty queue in turn until either
+    // the batch is full (maxBatchSizes holds the limit per queue) or maxBatchDelay elapsed since its first value was taken.
+    // Returns the index of the queue, nothing once the scheduler was closed and all queues are drained.
+    std::optional<size_t> popBatch(std::vector<T>& batch, const std::vector<size_t>& maxBatchSizes, std::chrono::microseconds maxBatchDelay)
+    {
+        return popBatch(batch, maxBatchSizes, maxBatchDelay, [](size_t, T&) { return true; });
+    }
+
+    // Like above, but every value taken is passed to admit(queueIdx, value) first. Values it rejects (returns false for)
+    // are left to the callback to dispose of and do not count towards the batch.
+    template <typename Admission>
+    std::optional<size_t> popBatch(std::vector<T>& batch, const std::vector<size_t>& maxBatchSizes, std::chrono::microseconds maxBatchDelay, Admission&& admit)
+    {
+        batch.clear();
+
+        T value;
+
+        std::unique_lock<std::mutex> lock{mtx_};
+
+        while (true)
+        {
+            bool rejected = false;
+
+            for (size_t attempt = 0; attempt < queues_.size(); attempt++)
+            {
+                const size_t queueIdx = nextQueueIdx_;
+
+                nextQueueIdx_ = (nextQueueIdx_ + 1) % queues_.size();
+
+                if (!queues_[queueIdx]->tryPop(value))
+                {
+                    continue;
+                }
+
+                lock.unlock();
+
+                if (!admit(queueIdx, value))
+                {
+                    rejected = true;
+                    lock.lock();
+                    continue;
+                }
+
+                batch.push_back(std::move(value));
+
+                const auto batchDeadline = std::chrono::steady_clock::now() + maxBatchDelay;
+
+                while (batch.size() < maxBatchSizes[queueIdx] && queues_[queueIdx]->popUntil(value, batchDeadline))
+                {
+                    if (admit(queueIdx, value))
+                    {
+                        batch.push_back(std::move(value));
+                    }
+                }
+
+                return queueIdx;
+            }
+
+            // Queues that held rejected values may hold further ones, which are looked at before waiting
+            if (rejected)
+            {
+                continue;
+            }
+
+            if (closed_)
+            {
+                return std::nullopt;
+            }
+
+            cvAvailable_.wait(lock);
+        }
+    }
+
+    // Wakes up blocked producers and all consumers, queued values are still handed out
+    void close()
+    {
+        for (auto& queue : queues_)
+        {
+            queue->close();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mtx_};
+            closed_ = true;
+        }
+        cvAvailable_.notify_all();
+    }
+
+    size_t getNrOfQueues() const noexcept { return queues_.size(); }
+    QueueStats getStats(size_t queueIdx) const { return queues_[queueIdx]->getStats(); }
+
+    private:
+    std::vector<std::unique_ptr<BoundedQueue<T>>> queues_;
+    std::mutex mtx_;
+    std::condition_variable cvAvailable_;
+    size_t nextQueueIdx_{0};
+    bool closed_{false};
+};
+
+#endif // #ifndef FAIR_SCHEDULER_H_
@@ -0,0 +1,45 @@
+#include "frame_pool.h"
+#include <algorithm>
+
+FramePool::FramePool(size_t nrOfFrames, size_t frameCapacity) : frames_(nrOfFrames), freeFrames_{std::max<size_t>(nrOfFrames, 1), OverflowPolicy::DropNewest}
+{
+    for (size_t frameIdx = 0; frameIdx < nrOfFrames; frameIdx++)
+    {
+        frames_[frameIdx].data = std::make_unique<uint8_t[]>(frameCapacity);
+        frames_[frameIdx].capacity = frameCapacity;
+
+        (void)freeFrames_.push(static_cast<uint32_t>(frameIdx));
+    }
+}
+
+FrameHandle FramePool::Acquire(size_t frameSize)
+{
+    uint32_t frameIdx;
+
+    if (!freeFrames_.tryPop(frameIdx))
+    {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+
+        return FrameHandle{};
+    }
+
+    acquired_.fetch_add(1, std::memory_order_relaxed);
+
+    Frame& frame = frames_[frameIdx];
+
+    if (frame.capacity < frameSize)
+    {
+        frame.data = std::make_unique<uint8_t[]>(frameSize);
+        frame.capacity = frameSize;
+
+        grown_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return FrameHandle{this, frameIdx, frame.data.get()};
+}
+
+FramePoolStats FramePool::getStats() const
+{
+    return FramePoolStats{acquired_.load(std::memory_order_relaxed), exhausted_.load(std::memory_order_relaxed),
+                          grown_.load(std::memory_order_relaxed), frames_.size()};
+}
@@ -0,0 +1,104 @@
+#ifndef FRAME_POOL_H_
+#define FRAME_POOL_H_
+
+#include "bounded_queue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class FramePool;
+
+struct FramePoolStats
+{
+    uint64_t acquired;
+    // Requests served while all frames were in use, the caller falls back to a heap allocation
+    uint64_t exhausted;
+    // Frames reallocated because a larger frame than ever before was requested
+    uint64_t grown;
+    size_t nrOfFrames;
+};
+
+// Exclusive ownership of a pooled frame buffer, which returns to the pool when the handle is destroyed.
+// An empty handle owns nothing.
+class FrameHandle
+{
+    public:
+    FrameHandle() = default;
+    FrameHandle(const FrameHandle& other) = delete;
+    FrameHandle& operator=(const FrameHandle& other) = delete;
+    FrameHandle(FrameHandle&& other) noexcept : pool_{std::exchange(other.pool_, nullptr)}, frameIdx_{other.frameIdx_}, data_{std::exchange(other.data_, nullptr)} {}
+    FrameHandle& operator=(FrameHandle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+
+            pool_ = std::exchange(other.pool_, nullptr);
+            frameIdx_ = other.frameIdx_;
+            data_ = std::exchange(other.data_, nullptr);
+        }
+
+        return *this;
+    }
+    ~FrameHandle() { reset(); }
+    explicit operator bool() const noexcept { return pool_ != nullptr; }
+    uint8_t* getData() const noexcept { return data_; }
+    void reset();
+
+    private:
+    friend class FramePool;
+
+    FrameHandle(FramePool* pool, uint32_t frameIdx, uint8_t* data) : pool_{pool}, frameIdx_{frameIdx}, data_{data} {}
+
+    FramePool* pool_{nullptr};
+    uint32_t frameIdx_{0};
+    uint8_t* data_{nullptr};
+};
+
+// Fixed number of frame buffers recycled from capture through display. Buffers are allocated up front
+// and only grow when a frame larger than their capacity is requested, so once every buffer has seen
+// the largest frame of a dataset, acquiring and releasing frames does not touch the heap anymore.
+// Acquire and release are lock-free, the pool has to outlive all of its handles.
+class FramePool
+{
+    public:
+    FramePool(size_t nrOfFrames, size_t frameCapacity);
+    FramePool(const FramePool& other) = delete;
+    FramePool& operator=(const FramePool& other) = delete;
+    // Returns an empty handle if all frames are in use
+    FrameHandle Acquire(size_t frameSize);
+    FramePoolStats getStats() const;
+
+    private:
+    friend class FrameHandle;
+
+    struct Frame
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity;
+    };
+
+    void Release(uint32_t frameIdx) { (void)freeFrames_.push(frameIdx); }
+
+    // Only the owner of a frame's handle accesses the frame
+    std::vector<Frame> frames_;
+    BoundedQueue<uint32_t> freeFrames_;
+    std::atomic<uint64_t> acquired_{0};
+    std::atomic<uint64_t> exhausted_{0};
+    std::atomic<uint64_t> grown_{0};
+};
+
+inline void FrameHandle::reset()
+{
+    if (pool_ != nullptr)
+    {
+        pool_->Release(frameIdx_);
+        pool_ = nullptr;
+        data_ = nullptr;
+    }
+}
+
+#endif // #ifndef FRAME_POOL_H_
@@ -0,0 +1,30 @@
+#ifndef FRAME_SOURCE_H_
+#define FRAME_SOURCE_H_
+
+#include "image.h"
+#include <cstdint>
+#include <string>
+
+struct FrameSourceStats
+{
+    uint64_t decoded;
+    // Decoded frames discarded by the source, e.g. because they exceeded the freshness budget
+    uint64_t dropped;
+    // Time spent decoding and since the source was opened
+    double decodeSeconds;
+    double elapsedSeconds;
+};
+
+// Produces frames in capture order, frames are numbered by the image provider
+class FrameSource
+{
+    public:
+    // Blocks until the next frame is available, returns an empty image once the source failed
+    virtual Image NextFrame() = 0;
+    virtual FrameSourceStats getStats() const = 0;
+    // Reason the source stopped producing frames, empty while it works
+    virtual std::string getError() const { return {}; }
+    virtual ~FrameSource() = default;
+};
+
+#endif // #ifndef FRAME_SOURCE_H_
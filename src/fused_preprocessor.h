@@ -0,0 +1,296 @@
+#ifndef FUSED_PREPROCESSOR_H_
+#define FUSED_PREPROCESSOR_H_
+
+#include "image_preprocessor.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+// Extent of the fused kernel output that is set at construction instead of being a template argument
+constexpr int kDynamicExtent{0};
+
+// Per channel scale and offset in RGB order, folding 1/255 scaling and mean/std normalization into one multiply-add
+struct NormCoefficients
+{
+    std::array<float, 3> scale;
+    std::array<float, 3> offset;
+};
+
+constexpr NormCoefficients MakeNormCoefficients(const std::array<ChannelNormParams, 3>& normParams)
+{
+    NormCoefficients coefficients{};
+
+    for (size_t channelIdx = 0; channelIdx < normParams.size(); channelIdx++)
+    {
+        coefficients.scale[channelIdx] = 1.0f / (255.0f * normParams[channelIdx].std);
+        coefficients.offset[channelIdx] = -normParams[channelIdx].mean / normParams[channelIdx].std;
+    }
+
+    return coefficients;
+}
+
+// Normalization coefficients that are computed at construction instead of being a template argument. Compile-time
+// coefficients are given by a type providing kNormCoefficients as static constexpr member, see static_pipeline.h.
+struct DynamicNormCoefficients {};
+
+struct ResampleWeight
+{
+    int srcIdx;
+    float weight;
+};
+
+// Box filter coverage of each destination pixel, matching cv::resize with INTER_AREA when shrinking
+void ComputeAreaWeights(int srcSize, int dstSize, std::vector<ResampleWeight>& weights, std::vector<int>& offsets);
+// Adds the weighted 8 bit source row to the float accumulator (SIMD), independent of the channel order
+void AccumulateRow(const uint8_t* srcRow, float rowWeight, float* accumulator, int size);
+
+// Single pass alternative to the resize/convert color/normalize/convert memory layout chain.
+// Resampling, BGR->RGB swap, normalization and the HWC->CHW planar write of each output row
+// happen in one loop that writes straight into the input tensor, without intermediate images.
+// With Height, Width and Coefficients given, output size and normalization are compile-time constants of the loops (see static_pipeline.h).
+template <int Height = kDynamicExtent, int Width = kDynamicExtent, typename Coefficients = DynamicNormCoefficients>
+class BasicFusedPreprocessor final : public TensorPreprocessor
+{
+    public:
+    BasicFusedPreprocessor(int height, int width, const std::array<ChannelNormParams, 3>& normParams) :
+        height_{height}, width_{width}, coefficients_{MakeNormCoefficients(normParams)}, rowBuffer_(static_cast<size_t>(width) * 3) {}
+    BasicFusedPreprocessor() : height_{Height}, width_{Width}, rowBuffer_(static_cast<size_t>(Width) * 3)
+    {
+        static_assert(Height != kDynamicExtent && Width != kDynamicExtent && !std::is_same_v<Coefficients, DynamicNormCoefficients>,
+                      "Only fully static kernels can be constructed without output size and normalization");
+    }
+    bool apply(const Image& image, float* tensor) override;
+
+    private:
+    int height() const
+    {
+        if constexpr (Height != kDynamicExtent)
+        {
+            return Height;
+        }
+        else
+        {
+            return height_;
+        }
+    }
+    int width() const
+    {
+        if constexpr (Width != kDynamicExtent)
+        {
+            return Width;
+        }
+        else
+        {
+            return width_;
+        }
+    }
+    float scale(size_t channelIdx) const
+    {
+        if constexpr (std::is_same_v<Coefficients, DynamicNormCoefficients>)
+        {
+            return coefficients_.scale[channelIdx];
+        }
+        else
+        {
+            return Coefficients::kNormCoefficients.scale[channelIdx];
+        }
+    }
+    float offset(size_t channelIdx) const
+    {
+        if constexpr (std::is_same_v<Coefficients, DynamicNormCoefficients>)
+        {
+            return coefficients_.offset[channelIdx];
+        }
+        else
+        {
+            return Coefficients::kNormCoefficients.offset[channelIdx];
+        }
+    }
+    // Area resampling is separable: source rows are weighted into srcRowBuffer_ (SIMD), which is then resampled horizontally into rowBuffer_
+    void resampleRow();
+    void storeRow(float* tensor, int dstRow, int dstCol, int cols);
+    void storeBorder(float* tensor, int dstRow, int dstCol, int cols);
+    int height_;
+    int width_;
+    NormCoefficients coefficients_{};
+    // Area resampling tables, rebuilt only when the source image size changes
+    cv::Size srcSize_;
+    std::vector<ResampleWeight> colWeights_;
+    std::vector<int> colOffsets_;
+    std::vector<ResampleWeight> rowWeights_;
+    std::vector<int> rowOffsets_;
+    // Interleaved BGR accumulator of the source rows covered by the output row being computed
+    std::vector<float> srcRowBuffer_;
+    // Interleaved BGR values of the output row being computed
+    std::vector<float> rowBuffer_;
+};
+
+using FusedPreprocessor = BasicFusedPreprocessor<>;
+
+template <int Height, int Width, typename Coefficients>
+void BasicFusedPreprocessor<Height, Width, Coefficients>::resampleRow()
+{
+    // Horizontal pass, once per output row over the vertically accumulated source row
+    const float* accumulator = srcRowBuffer_.data();
+
+    for (int dstCol = 0; dstCol < width(); dstCol++)
+    {
+        float blue = 0.0f;
+        float green = 0.0f;
+        float red = 0.0f;
+
+        for (int weightIdx = colOffsets_[dstCol]; weightIdx < colOffsets_[dstCol + 1]; weightIdx++)
+        {
+            const float* pixel = accumulator + 3 * colWeights_[weightIdx].srcIdx;
+            const float colWeight = colWeights_[weightIdx].weight;
+
+            blue += colWeight * pixel[0];
+            green += colWeight * pixel[1];
+            red += colWeight * pixel[2];
+        }
+
+        rowBuffer_[3 * dstCol] = blue;
+        rowBuffer_[3 * dstCol + 1] = green;
+        rowBuffer_[3 * dstCol + 2] = red;
+    }
+}
+
+template <int Height, int Width, typename Coefficients>
+void BasicFusedPreprocessor<Height, Width, Coefficients>::storeRow(float* tensor, int dstRow, int dstCol, int cols)
+{
+    const size_t planeSize = static_cast<size_t>(height()) * width();
+
+    float* redPlane = tensor + static_cast<size_t>(dstRow) * width() + dstCol;
+    float* greenPlane = redPlane + planeSize;
+    float* bluePlane = greenPlane + planeSize;
+
+    const float* pixels = rowBuffer_.data();
+
+    int col = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+
+    const cv::v_float32 redScale = cv::vx_setall_f32(scale(0));
+    const cv::v_float32 greenScale = cv::vx_setall_f32(scale(1));
+    const cv::v_float32 blueScale = cv::vx_setall_f32(scale(2));
+    const cv::v_float32 redOffset = cv::vx_setall_f32(offset(0));
+    const cv::v_float32 greenOffset = cv::vx_setall_f32(offset(1));
+    const cv::v_float32 blueOffset = cv::vx_setall_f32(offset(2));
+
+    for (; col <= cols - lanes; col += lanes)
+    {
+        cv::v_float32 blue, green, red;
+
+        cv::v_load_deinterleave(pixels + 3 * col, blue, green, red);
+
+        // Resampled values are rounded to 8 bit levels, as the reference resize produces an 8 bit image
+        cv::v_store(redPlane + col, cv::v_fma(cv::v_cvt_f32(cv::v_round(red)), redScale, redOffset));
+        cv::v_store(greenPlane + col, cv::v_fma(cv::v_cvt_f32(cv::v_round(green)), greenScale, greenOffset));
+        cv::v_store(bluePlane + col, cv::v_fma(cv::v_cvt_f32(cv::v_round(blue)), blueScale, blueOffset));
+    }
+#endif
+
+    for (; col < cols; col++)
+    {
+        redPlane[col] = std::nearbyint(pixels[3 * col + 2]) * scale(0) + offset(0);
+        greenPlane[col] = std::nearbyint(pixels[3 * col + 1]) * scale(1) + offset(1);
+        bluePlane[col] = std::nearbyint(pixels[3 * col]) * scale(2) + offset(2);
+    }
+}
+
+template <int Height, int Width, typename Coefficients>
+void BasicFusedPreprocessor<Height, Width, Coefficients>::storeBorder(float* tensor, int dstRow, int dstCol, int cols)
+{
+    const size_t planeSize = static_cast<size_t>(height()) * width();
+
+    float* plane = tensor + static_cast<size_t>(dstRow) * width() + dstCol;
+
+    // Border pixels are black, i.e. normalization reduces them to the channel offset
+    for (size_t channelIdx = 0; channelIdx < 3; channelIdx++)
+    {
+        std::fill_n(plane + channelIdx * planeSize, cols, offset(channelIdx));
+    }
+}
+
+template <int Height, int Width, typename Coefficients>
+bool BasicFusedPreprocessor<Height, Width, Coefficients>::apply(const Image& image, float* tensor)
+{
+    const cv::Mat& src = image.matrix;
+
+    const int height = this->height();
+    const int width = this->width();
+
+    if (src.type() != CV_8UC3 || image.fmt != ColorFormat::BGR || image.layout != MemoryLayout::HWC)
+    {
+        return false;
+    }
+
+    if (src.rows == height && src.cols == width)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            std::copy_n(src.ptr<uint8_t>(row), 3 * width, rowBuffer_.begin());
+            storeRow(tensor, row, 0, width);
+        }
+    }
+    else if (height > src.rows && width >= src.cols)
+    {
+        // Pad, centering the image the same way ResizeTransformation does
+        const int borderTop = static_cast<int>(std::round((height - src.rows) / 2.0f));
+        const int borderLeft = static_cast<int>(std::round((width - src.cols) / 2.0f));
+        const int borderRight = width - src.cols - borderLeft;
+
+        for (int row = 0; row < height; row++)
+        {
+            const int srcRow = row - borderTop;
+
+            if (srcRow < 0 || srcRow >= src.rows)
+            {
+                storeBorder(tensor, row, 0, width);
+                continue;
+            }
+
+            std::copy_n(src.ptr<uint8_t>(srcRow), 3 * src.cols, rowBuffer_.begin());
+            storeBorder(tensor, row, 0, borderLeft);
+            storeRow(tensor, row, borderLeft, src.cols);
+            storeBorder(tensor, row, borderLeft + src.cols, borderRight);
+        }
+    }
+    else if (height <= src.rows && width <= src.cols)
+    {
+        if (srcSize_ != src.size())
+        {
+            ComputeAreaWeights(src.cols, width, colWeights_, colOffsets_);
+            ComputeAreaWeights(src.rows, height, rowWeights_, rowOffsets_);
+            srcRowBuffer_.resize(static_cast<size_t>(src.cols) * 3);
+            srcSize_ = src.size();
+        }
+
+        for (int row = 0; row < height; row++)
+        {
+            std::fill(srcRowBuffer_.begin(), srcRowBuffer_.end(), 0.0f);
+
+            for (int weightIdx = rowOffsets_[row]; weightIdx < rowOffsets_[row + 1]; weightIdx++)
+            {
+                AccumulateRow(src.ptr<uint8_t>(rowWeights_[weightIdx].srcIdx), rowWeights_[weightIdx].weight, srcRowBuffer_.data(),
+                              static_cast<int>(srcRowBuffer_.size()));
+            }
+
+            resampleRow();
+            storeRow(tensor, row, 0, width);
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+#endif // #ifndef FUSED_PREPROCESSOR_H_
@@ -0,0 +1,71 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// 64 bit FNV-1a, seeding with a previous hash value chains several fields into one hash
+constexpr uint64_t kFnv1aOffsetBasis{14695981039346656037ULL};
+
+inline uint64_t Fnv1aHash(const void* data, size_t size, uint64_t seed = kFnv1aOffsetBasis)
+{
+    constexpr uint64_t kFnv1aPrime{1099511628211ULL};
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+
+    for (size_t byteIdx = 0; byteIdx < size; byteIdx++)
+    {
+        hash ^= bytes[byteIdx];
+        hash *= kFnv1aPrime;
+    }
+
+    return hash;
+}
+
+inline uint64_t Fnv1aHash(std::string_view str, uint64_t seed = kFnv1aOffsetBasis)
+{
+    return Fnv1aHash(str.data(), str.size(), seed);
+}
+
+template <typename T>
+inline uint64_t Fnv1aHashValue(const T& value, uint64_t seed = kFnv1aOffsetBasis)
+{
+    return Fnv1aHash(&value, sizeof(value), seed);
+}
+
+// Hash of large buffers such as frame pixels, mixing 8 bytes per step instead of FNV-1a's single byte
+inline uint64_t WordHash(const void* data, size_t size, uint64_t seed = kFnv1aOffsetBasis)
+{
+    constexpr uint64_t kMultiplier{0x9E3779B97F4A7C15ULL};
+
+    auto mix = [](uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDULL;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ULL;
+        value ^= value >> 33;
+
+        return value;
+    };
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    uint64_t hash = seed ^ (size * kMultiplier);
+    size_t byteIdx = 0;
+
+    for (; byteIdx + sizeof(uint64_t) <= size; byteIdx += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + byteIdx, sizeof(word));
+
+        hash = (hash ^ mix(word)) * kMultiplier;
+    }
+
+    return mix(Fnv1aHash(bytes + byteIdx, size - byteIdx, hash));
+}
+
+#endif // #ifndef HASH_H_
@@ -0,0 +1,575 @@
+#include "config.h"
+#include "allocation_counter.h"
+#include "runtime.h"
+#include "model_handler.h"
+#include "postprocessor.h"
+#include "image_provider.h"
+#include "thread_placement.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <numeric>
+#include <memory>
+#include <optional>
+#include <cstdint>
+#include <ctime>
+
+// Headless benchmark of the capture -> preprocess -> inference -> postprocess path, without display and pacing.
+// Stages run back to back on the calling thread, so each latency sample covers exactly one stage.
+
+enum BenchStage : size_t
+{
+    Capture = 0,
+    Preprocess = 1,
+    Inference = 2,
+    Postprocess = 3,
+    Total = 4,
+    NrOfStages = 5
+};
+
+static constexpr std::array<const char*, NrOfStages> kStageNames{"capture", "preprocess", "inference", "postprocess", "total"};
+
+struct BenchOptions
+{
+    std::chrono::duration<double> duration{10.0};
+    // 0 runs for the full duration
+    uint64_t maxFrames{0};
+    std::string jsonPath;
+    // Frames after which allocations are counted, buffers and lookup tables have reached their final size by then
+    uint64_t warmupFrames{100};
+    // Fail if one of the checked stages allocates after the warm-up
+    bool assertNoAllocations{false};
+    // Stages checked by assertNoAllocations, inference is never checked
+    std::array<bool, NrOfStages> noAllocationStages{true, true, false, true, false};
+};
+
+struct LatencySummary
+{
+    double p50;
+    double p95;
+    double p99;
+    double mean;
+    double max;
+};
+
+static void PrintUsage(const char* const programName)
+{
+    std::cout << "Usage: " << programName << " [bench options] [Icarus options]\n"
+              << "  --duration-s <S>     Benchmark duration in seconds (default: 10)\n"
+              << "  --frames <N>         Stop after N frames, 0 runs for the full duration (default: 0)\n"
+              << "  --json <FILE>        Write the results as JSON to FILE\n"
+              << "  --warmup-frames <N>  Frames excluded from the allocation counts (default: 100)\n"
+              << "  --assert-no-alloc    Fail if capturing, preprocessing or postprocessing allocate heap memory after the warm-up\n"
+              << "  --no-alloc-stages <LIST>  Stages checked by --assert-no-alloc, comma separated from capture, preprocess\n"
+              << "                       and postprocess (default: all three)\n"
+              << "Batch size, preprocessing, decoding and dataset options are shared with Icarus, see Icarus --help\n";
+}
+
+static double ParseBenchValue(const std::string& option, const char* const value)
+{
+    char* end = nullptr;
+    double parsedValue = std::strtod(value, &end);
+
+    if (end == value || *end != '\0' || parsedValue < 0.0)
+    {
+        std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return parsedValue;
+}
+
+static std::array<bool, NrOfStages> ParseNoAllocationStages(const std::string& option, const std::string& value)
+{
+    std::array<bool, NrOfStages> stages{};
+
+    size_t begin = 0;
+
+    while (begin <= value.size())
+    {
+        const size_t end = std::min(value.find(',', begin), value.size());
+        const std::string stageName = value.substr(begin, end - begin);
+
+        auto stageIt = std::find(kStageNames.cbegin(), kStageNames.cend(), stageName);
+        const size_t stageIdx = static_cast<size_t>(stageIt - kStageNames.cbegin());
+
+        if (stageIdx != Capture && stageIdx != Preprocess && stageIdx != Postprocess)
+        {
+            std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        stages[stageIdx] = true;
+        begin = end + 1;
+    }
+
+    return stages;
+}
+
+// Extracts the benchmark options, all other arguments are left for ParseCommandLine
+static BenchOptions ParseBenchOptions(int argc, char* argv[], std::vector<char*>& remainingArgs)
+{
+    BenchOptions benchOptions;
+
+    remainingArgs.push_back(argv[0]);
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        const std::string option{argv[argIdx]};
+
+        if (option == "--help")
+        {
+            PrintUsage(argv[0]);
+
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (option == "--assert-no-alloc")
+        {
+            benchOptions.assertNoAllocations = true;
+            continue;
+        }
+
+        const bool benchOption = (option == "--duration-s" || option == "--frames" || option == "--json" || option == "--warmup-frames" ||
+                                  option == "--no-alloc-stages");
+
+        if (!benchOption)
+        {
+            remainingArgs.push_back(argv[argIdx]);
+            continue;
+        }
+
+        if (argIdx + 1 >= argc)
+        {
+            std::cerr << "Missing value for option: " << option << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        const char* const value = argv[++argIdx];
+
+        if (option == "--duration-s")
+        {
+            benchOptions.duration = std::chrono::duration<double>{ParseBenchValue(option, value)};
+        }
+        else if (option == "--frames")
+        {
+            benchOptions.maxFrames = static_cast<uint64_t>(ParseBenchValue(option, value));
+        }
+        else if (option == "--warmup-frames")
+        {
+            benchOptions.warmupFrames = static_cast<uint64_t>(ParseBenchValue(option, value));
+        }
+        else if (option == "--no-alloc-stages")
+        {
+            benchOptions.noAllocationStages = ParseNoAllocationStages(option, value);
+        }
+        else
+        {
+            benchOptions.jsonPath = value;
+        }
+    }
+
+    return benchOptions;
+}
+
+// Nearest-rank percentiles of the latency samples in microseconds
+static LatencySummary Summarize(std::vector<double>& samples)
+{
+    if (samples.empty())
+    {
+        return LatencySummary{0.0, 0.0, 0.0, 0.0, 0.0};
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    auto percentile = [&samples](double fraction)
+    {
+        const size_t rank = static_cast<size_t>(std::ceil(fraction * samples.size()));
+
+        return samples[std::max<size_t>(rank, 1) - 1];
+    };
+
+    const double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+
+    return LatencySummary{percentile(0.50), percentile(0.95), percentile(0.99), mean, samples.back()};
+}
+
+static double ElapsedUs(std::chrono::steady_clock::time_point startTime, std::chrono::steady_clock::time_point endTime)
+{
+    return std::chrono::duration<double, std::micro>(endTime - startTime).count();
+}
+
+static double CpuUs(clockid_t clockId)
+{
+    timespec cpuTime{};
+    (void)::clock_gettime(clockId, &cpuTime);
+
+    return cpuTime.tv_sec * 1e6 + cpuTime.tv_nsec / 1e3;
+}
+
+// CPU time consumed by the calling thread, the one running the stages
+static double ThreadCpuUs()
+{
+    return CpuUs(CLOCK_THREAD_CPUTIME_ID);
+}
+
+// CPU time consumed by all threads of the process, including the ONNX Runtime thread pools and the decoding threads
+static double ProcessCpuUs()
+{
+    return CpuUs(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<char*> remainingArgs;
+
+    const BenchOptions benchOptions = ParseBenchOptions(argc, argv, remainingArgs);
+    const Config config = ParseCommandLine(static_cast<int>(remainingArgs.size()), remainingArgs.data());
+
+    // All stages run on this thread, which takes the inference placement
+    (void)PinCurrentThread(SelectCpuList(config.placement.inference, 0));
+
+    Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "Icarus_bench"};
+
+    OrtThreadPlacement ortThreadPlacement{config.placement.onnxRuntime};
+
+    const int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const int intraOpThreads = (config.intraOpThreads > 0) ? config.intraOpThreads : hardwareThreads;
+
+    MobileNetV2ModelHandler modelHandler{config.maxBatchSize, config.modelPrecision};
+
+    modelHandler.BuildPreprocessPipeline(config.preprocessMode);
+    modelHandler.BuildPostprocessor(config.topK);
+
+    SharedSessionResources sessionResources;
+    sessionResources.threadPlacement = &ortThreadPlacement;
+
+    Runtime runtime{env, sessionResources};
+
+    std::optional<InGraphPreprocessing> inGraphPreprocessing;
+
+    if (config.preprocessMode == PreprocessMode::InGraph)
+    {
+        inGraphPreprocessing = modelHandler.getInGraphPreprocessing();
+    }
+
+    runtime.Prepare(modelHandler.getModelPath(), modelHandler.getInputBatches(), 1, intraOpThreads, inGraphPreprocessing,
+                    RuntimeStartupOptions{config.modelCacheDir, config.warmupRuns});
+    runtime.PrintModelInfo();
+    runtime.PrintStartupStats();
+
+    // The frame pool and the decoding threads are placed together
+    std::optional<ScopedThreadPlacement> capturePlacement{std::in_place, config.placement.capture};
+
+    ImageProviderOptions providerOptions;
+    providerOptions.imagesPath = config.imagesPath;
+    providerOptions.videoPath = config.videoPath;
+    providerOptions.maxFrameAge = config.maxFrameAge;
+    providerOptions.decodeThreads = config.decodeThreads;
+    providerOptions.readAheadDepth = config.readAheadDepth;
+
+    if (config.reducedDecode)
+    {
+        providerOptions.targetHeight = modelHandler.getInputHeight();
+        providerOptions.targetWidth = modelHandler.getInputWidth();
+    }
+
+    if (!config.packPath.empty())
+    {
+        providerOptions.packedDataset = std::make_shared<const PackedDataset>(config.packPath);
+    }
+
+    // Frames of the current batch, the ones decoded ahead (at least two buffered video frames) and the one being decoded
+    if (providerOptions.packedDataset == nullptr || providerOptions.packedDataset->getPayload() == PackPayload::Encoded)
+    {
+        providerOptions.framePool = std::make_shared<FramePool>(static_cast<size_t>(config.maxBatchSize) + std::max<size_t>(config.readAheadDepth, 2) + 1, 0);
+    }
+
+    ImageProvider imgProvider{providerOptions};
+
+    capturePlacement.reset();
+
+    const size_t batchSize = static_cast<size_t>(runtime.getMaxBatchSize());
+    const int64_t inputSize = modelHandler.getInputSize();
+    const int64_t frameSize = modelHandler.getInputHeight() * modelHandler.getInputWidth() * 3;
+
+    RuntimeSlot& slot = runtime.getSlot(0);
+
+    std::vector<Image> batch;
+    batch.reserve(batchSize);
+
+    std::vector<Prediction> predictions;
+
+    // Capture samples are taken per image, all other stages per batch
+    std::array<std::vector<double>, NrOfStages> latencySamples;
+
+    // CPU time of the bench thread and wall time while a stage ran. Work on other threads (the ONNX Runtime pools, decoding threads
+    // running ahead) cannot be attributed to a stage, it only shows in the CPU time of the process.
+    std::array<double, NrOfStages> stageCpuUs{};
+    std::array<double, NrOfStages> stageWallUs{};
+
+    // Heap allocations of all threads while a stage ran, counted once the warm-up is over
+    std::array<uint64_t, NrOfStages> stageAllocations{};
+    // Allocations inside the image decoders, which are exempt from the counts like those inside ONNX Runtime
+    uint64_t exemptAllocations = 0;
+    uint64_t measuredFrames = 0;
+
+    uint64_t nrOfFrames = 0;
+
+    const auto benchStartTime = std::chrono::steady_clock::now();
+    const double benchStartProcessCpuUs = ProcessCpuUs();
+    const auto benchDeadline = benchStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(benchOptions.duration);
+
+    while (std::chrono::steady_clock::now() < benchDeadline && (benchOptions.maxFrames == 0 || nrOfFrames < benchOptions.maxFrames))
+    {
+        const size_t nrOfImages = (benchOptions.maxFrames == 0) ? batchSize : std::min<uint64_t>(batchSize, benchOptions.maxFrames - nrOfFrames);
+
+        const auto batchStartTime = std::chrono::steady_clock::now();
+        const double batchStartCpuUs = ThreadCpuUs();
+
+        std::array<uint64_t, NrOfStages> batchAllocations{};
+        const uint64_t batchStartExemptAllocations = GetExemptAllocationCount();
+
+        batch.clear();
+
+        for (size_t imageIdx = 0; imageIdx < nrOfImages; imageIdx++)
+        {
+            const auto captureStartTime = std::chrono::steady_clock::now();
+            const uint64_t captureStartAllocations = GetAllocationCount();
+            std::optional<Image> img = imgProvider.GetImage();
+
+            if (!img.has_value())
+            {
+                std::cerr << imgProvider.getSourceError() << std::endl;
+
+                return EXIT_FAILURE;
+            }
+
+            batch.push_back(std::move(*img));
+            batchAllocations[Capture] += GetAllocationCount() - captureStartAllocations;
+            latencySamples[Capture].push_back(ElapsedUs(captureStartTime, std::chrono::steady_clock::now()));
+        }
+
+        const auto preprocessStartTime = std::chrono::steady_clock::now();
+        const double preprocessStartCpuUs = ThreadCpuUs();
+        const uint64_t preprocessStartAllocations = GetAllocationCount();
+
+        for (size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++)
+        {
+            if (config.preprocessMode == PreprocessMode::InGraph)
+            {
+                modelHandler.PreprocessFrame(batch[batchIdx], slot.getFrameData() + batchIdx * frameSize);
+            }
+            else
+            {
+                modelHandler.Preprocess(batch[batchIdx], slot.getInputData() + batchIdx * inputSize);
+            }
+        }
+
+        const auto inferenceStartTime = std::chrono::steady_clock::now();
+        const double inferenceStartCpuUs = ThreadCpuUs();
+        const uint64_t inferenceStartAllocations = GetAllocationCount();
+
+        runtime.Execute(0, batch.size());
+
+        const auto postprocessStartTime = std::chrono::steady_clock::now();
+        const double postprocessStartCpuUs = ThreadCpuUs();
+        const uint64_t postprocessStartAllocations = GetAllocationCount();
+
+        modelHandler.Postprocess(slot.getOutputData(), batch.size(), predictions);
+
+        const auto batchEndTime = std::chrono::steady_clock::now();
+        const double batchEndCpuUs = ThreadCpuUs();
+        const uint64_t batchEndAllocations = GetAllocationCount();
+
+        batchAllocations[Preprocess] = inferenceStartAllocations - preprocessStartAllocations;
+        batchAllocations[Inference] = postprocessStartAllocations - inferenceStartAllocations;
+        batchAllocations[Postprocess] = batchEndAllocations - postprocessStartAllocations;
+        batchAllocations[Total] = batchAllocations[Capture] + batchAllocations[Preprocess] + batchAllocations[Inference] + batchAllocations[Postprocess];
+
+        if (nrOfFrames >= benchOptions.warmupFrames)
+        {
+            for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+            {
+                stageAllocations[stageIdx] += batchAllocations[stageIdx];
+            }
+
+            exemptAllocations += GetExemptAllocationCount() - batchStartExemptAllocations;
+
+            measuredFrames += batch.size();
+        }
+
+        latencySamples[Preprocess].push_back(ElapsedUs(preprocessStartTime, inferenceStartTime));
+        latencySamples[Inference].push_back(ElapsedUs(inferenceStartTime, postprocessStartTime));
+        latencySamples[Postprocess].push_back(ElapsedUs(postprocessStartTime, batchEndTime));
+        latencySamples[Total].push_back(ElapsedUs(batchStartTime, batchEndTime));
+
+        stageCpuUs[Capture] += preprocessStartCpuUs - batchStartCpuUs;
+        stageCpuUs[Preprocess] += inferenceStartCpuUs - preprocessStartCpuUs;
+        stageCpuUs[Inference] += postprocessStartCpuUs - inferenceStartCpuUs;
+        stageCpuUs[Postprocess] += batchEndCpuUs - postprocessStartCpuUs;
+        stageCpuUs[Total] += batchEndCpuUs - batchStartCpuUs;
+        stageWallUs[Capture] += ElapsedUs(batchStartTime, preprocessStartTime);
+        stageWallUs[Preprocess] += ElapsedUs(preprocessStartTime, inferenceStartTime);
+        stageWallUs[Inference] += ElapsedUs(inferenceStartTime, postprocessStartTime);
+        stageWallUs[Postprocess] += ElapsedUs(postprocessStartTime, batchEndTime);
+        stageWallUs[Total] += ElapsedUs(batchStartTime, batchEndTime);
+
+        nrOfFrames += batch.size();
+    }
+
+    const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - benchStartTime).count();
+    // Average number of busy cores of the whole process
+    const double processCpuUtilization = (elapsedSeconds > 0.0) ? (ProcessCpuUs() - benchStartProcessCpuUs) * 1e-6 / elapsedSeconds : 0.0;
+    const double imagesPerSecond = (elapsedSeconds > 0.0) ? nrOfFrames / elapsedSeconds : 0.0;
+
+    std::array<LatencySummary, NrOfStages> summaries;
+
+    for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+    {
+        summaries[stageIdx] = Summarize(latencySamples[stageIdx]);
+    }
+
+    std::cout << "Frames: " << nrOfFrames << " Elapsed: " << elapsedSeconds << "s Throughput: " << imagesPerSecond << " images/s"
+              << " Batch size: " << batchSize << "\n";
+
+    const FrameSourceStats sourceStats = imgProvider.getSourceStats();
+    const double sourceDecodeRate = (sourceStats.elapsedSeconds > 0.0) ? sourceStats.decoded / sourceStats.elapsedSeconds : 0.0;
+    const double sourceDropRate = (sourceStats.decoded > 0) ? static_cast<double>(sourceStats.dropped) / sourceStats.decoded : 0.0;
+
+    std::cout << "Frame source: decoded " << sourceStats.decoded << " (" << sourceDecodeRate << " frames/s), dropped " << sourceStats.dropped
+              << " (" << sourceDropRate * 100.0 << "%)\n";
+
+    for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+    {
+        const LatencySummary& summary = summaries[stageIdx];
+
+        std::cout << kStageNames[stageIdx] << ((stageIdx == Capture) ? " (per image)" : " (per batch)") << ": p50 " << summary.p50 << "us, p95 "
+                  << summary.p95 << "us, p99 " << summary.p99 << "us, mean " << summary.mean << "us, max " << summary.max << "us\n";
+    }
+
+    std::array<double, NrOfStages> allocationsPerFrame{};
+
+    for (size_t stageIdx = 0; stageIdx < NrOfStages && measuredFrames > 0; stageIdx++)
+    {
+        allocationsPerFrame[stageIdx] = static_cast<double>(stageAllocations[stageIdx]) / measuredFrames;
+    }
+
+    // Share of the time the stage ran during which the bench thread was on a core
+    std::array<double, NrOfStages> cpuUtilization{};
+
+    std::cout << "CPU utilization of the bench thread:";
+
+    for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+    {
+        cpuUtilization[stageIdx] = (stageWallUs[stageIdx] > 0.0) ? stageCpuUs[stageIdx] / stageWallUs[stageIdx] : 0.0;
+
+        std::cout << " " << kStageNames[stageIdx] << " " << cpuUtilization[stageIdx];
+    }
+
+    std::cout << "\nCPU utilization of the process (cores): " << processCpuUtilization << "\n";
+
+    std::cout << "Heap allocations per frame after " << benchOptions.warmupFrames << " warm-up frames:";
+
+    for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+    {
+        std::cout << " " << kStageNames[stageIdx] << " " << allocationsPerFrame[stageIdx];
+    }
+
+    std::cout << ", exempt (image decoders) " << ((measuredFrames > 0) ? static_cast<double>(exemptAllocations) / measuredFrames : 0.0) << "\n";
+
+    if (!benchOptions.jsonPath.empty())
+    {
+        std::ofstream ofstrm{benchOptions.jsonPath, std::ios::out | std::ios::trunc};
+
+        if (!ofstrm.is_open())
+        {
+            std::cerr << "Could not open file: " << benchOptions.jsonPath << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        ofstrm << "{\n"
+               << "  \"frames\": " << nrOfFrames << ",\n"
+               << "  \"elapsed_s\": " << elapsedSeconds << ",\n"
+               << "  \"images_per_s\": " << imagesPerSecond << ",\n"
+               << "  \"batch_size\": " << batchSize << ",\n"
+               << "  \"intra_op_threads\": " << intraOpThreads << ",\n"
+               << "  \"source_decode_fps\": " << sourceDecodeRate << ",\n"
+               << "  \"source_drop_rate\": " << sourceDropRate << ",\n"
+               << "  \"startup_s\": {\"total\": " << runtime.getStartupStats().totalSeconds << ", \"session\": " << runtime.getStartupStats().sessionSeconds
+               << ", \"warmup\": " << runtime.getStartupStats().warmupSeconds << ", \"model_cache_hit\": " << (runtime.getStartupStats().cacheHit ? "true" : "false") << "},\n"
+               << "  \"stages_us\": {\n";
+
+        for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+        {
+            const LatencySummary& summary = summaries[stageIdx];
+
+            ofstrm << "    \"" << kStageNames[stageIdx] << "\": {\"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+                   << ", \"mean\": " << summary.mean << ", \"max\": " << summary.max << "}" << ((stageIdx + 1 < NrOfStages) ? ",\n" : "\n");
+        }
+
+        ofstrm << "  },\n"
+               << "  \"allocations_per_frame\": {";
+
+        for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+        {
+            ofstrm << "\"" << kStageNames[stageIdx] << "\": " << allocationsPerFrame[stageIdx] << ((stageIdx + 1 < NrOfStages) ? ", " : "");
+        }
+
+        ofstrm << "},\n"
+               << "  \"cpu_utilization\": {";
+
+        for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+        {
+            ofstrm << "\"" << kStageNames[stageIdx] << "\": " << cpuUtilization[stageIdx] << ((stageIdx + 1 < NrOfStages) ? ", " : "");
+        }
+
+        ofstrm << "},\n"
+               << "  \"process_cpu_utilization\": " << processCpuUtilization << "\n"
+               << "}\n";
+    }
+
+    // Inference is exempt, allocations inside ONNX Runtime are beyond the control of the pipeline
+    if (benchOptions.assertNoAllocations)
+    {
+        if (measuredFrames == 0)
+        {
+            std::cerr << "No frames left after the warm-up to check for heap allocations" << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        uint64_t pipelineAllocations = 0;
+        std::string checkedStages;
+
+        for (size_t stageIdx = 0; stageIdx < NrOfStages; stageIdx++)
+        {
+            if (benchOptions.noAllocationStages[stageIdx])
+            {
+                pipelineAllocations += stageAllocations[stageIdx];
+                checkedStages += checkedStages.empty() ? kStageNames[stageIdx] : std::string{", "} + kStageNames[stageIdx];
+            }
+        }
+
+        if (pipelineAllocations > 0)
+        {
+            std::cerr << "Stages " << checkedStages << " allocated heap memory " << pipelineAllocations << " times in "
+                      << measuredFrames << " frames after the warm-up" << std::endl;
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
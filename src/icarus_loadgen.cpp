@@ -0,0 +1,328 @@
+#include "ipc_protocol.h"
+#include "shared_frame_ring.h"
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Load generator for Icarus_server. Every client connects with a frame ring of its own and keeps as many requests
+// in flight as the ring has slots. A slot is refilled with the next test image as soon as its response arrived.
+
+struct LoadgenOptions
+{
+    std::string socketPath{kDefaultSocketPath};
+    std::string modelName{"mobilenetv2"};
+    std::string imagesPath{"assets/images/"};
+    size_t nrOfClients{4};
+    // Requests in flight per client, i.e. slots of its frame ring
+    size_t pipelineDepth{4};
+    std::chrono::duration<double> duration{10.0};
+};
+
+struct ClientResult
+{
+    uint64_t responses{0};
+    uint64_t failures{0};
+    std::vector<double> latenciesUs;
+};
+
+static void PrintUsage(const char* const programName)
+{
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "  --socket <PATH>      Socket of Icarus_server (default: " << kDefaultSocketPath << ")\n"
+              << "  --model <NAME>       Model the frames are classified with (default: mobilenetv2)\n"
+              << "  --images <DIR>       Directory of the test images sent in turn (default: assets/images/)\n"
+              << "  --clients <N>        Concurrent client connections (default: 4)\n"
+              << "  --depth <N>          Requests in flight per client (default: 4)\n"
+              << "  --duration-s <S>     Duration of the run in seconds (default: 10)\n"
+              << "  --help               Print this message\n";
+}
+
+static double ParseLoadgenValue(const std::string& option, const char* const value, double minValue)
+{
+    char* end = nullptr;
+    double parsedValue = std::strtod(value, &end);
+
+    if (end == value || *end != '\0' || parsedValue < minValue)
+    {
+        std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return parsedValue;
+}
+
+static LoadgenOptions ParseLoadgenOptions(int argc, char* argv[])
+{
+    LoadgenOptions options;
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        const std::string option{argv[argIdx]};
+
+        if (option == "--help")
+        {
+            PrintUsage(argv[0]);
+
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (argIdx + 1 >= argc)
+        {
+            std::cerr << "Missing value for option: " << option << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        const char* const value = argv[++argIdx];
+
+        if (option == "--socket")
+        {
+            options.socketPath = value;
+        }
+        else if (option == "--model")
+        {
+            options.modelName = value;
+        }
+        else if (option == "--images")
+        {
+            options.imagesPath = value;
+        }
+        else if (option == "--clients")
+        {
+            options.nrOfClients = static_cast<size_t>(ParseLoadgenValue(option, value, 1.0));
+        }
+        else if (option == "--depth")
+        {
+            options.pipelineDepth = static_cast<size_t>(ParseLoadgenValue(option, value, 1.0));
+        }
+        else if (option == "--duration-s")
+        {
+            options.duration = std::chrono::duration<double>{ParseLoadgenValue(option, value, 0.0)};
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << option << std::endl;
+            PrintUsage(argv[0]);
+
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    if (options.modelName.size() >= kMaxModelNameLength)
+    {
+        std::cerr << "Model name too long: " << options.modelName << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return options;
+}
+
+// Decoded once up front, so that the load generator measures the server instead of JPEG decoding
+static std::vector<cv::Mat> LoadImages(const std::string& imagesPath)
+{
+    std::vector<cv::Mat> images;
+
+    for (const auto& entry : std::filesystem::directory_iterator(imagesPath))
+    {
+        cv::Mat image = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+
+        if (!image.empty())
+        {
+            images.push_back(image.isContinuous() ? image : image.clone());
+        }
+    }
+
+    if (images.empty())
+    {
+        std::cerr << "No images found in: " << imagesPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return images;
+}
+
+static int Connect(const std::string& socketPath)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    const int socketFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (socketFd < 0 || ::connect(socketFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::cerr << "Could not connect to: " << socketPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return socketFd;
+}
+
+void ClientThread(const LoadgenOptions& options, const std::vector<cv::Mat>& images, size_t slotSize, size_t clientIdx,
+                  std::chrono::steady_clock::time_point deadline, ClientResult& result)
+{
+    const int socketFd = Connect(options.socketPath);
+
+    auto ring = SharedFrameRing::Create(options.pipelineDepth, slotSize);
+
+    if (ring == nullptr)
+    {
+        std::cerr << "Could not create frame ring" << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    HelloRequest hello{kProtocolMagic, kProtocolVersion, static_cast<uint32_t>(options.pipelineDepth), static_cast<uint32_t>(slotSize), {}};
+    std::strncpy(hello.modelName.data(), options.modelName.c_str(), hello.modelName.size() - 1);
+
+    HelloResponse helloResponse{};
+
+    if (!SendMessageWithFd(socketFd, &hello, sizeof(hello), ring->getFd()) || !ReceiveMessage(socketFd, &helloResponse, sizeof(helloResponse)) ||
+        helloResponse.status != ResponseStatus::Ok)
+    {
+        std::cerr << "Server rejected client, status " << static_cast<uint32_t>(helloResponse.status) << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<std::chrono::steady_clock::time_point> sendTimes(options.pipelineDepth);
+
+    // Clients start at different images, so that concurrent batches mix different frames
+    size_t nextImageIdx = clientIdx;
+    uint64_t nextRequestId = 0;
+
+    // Copies the next test image into the slot, like a capture driver would, and hands the slot to the server
+    auto sendRequest = [&](uint32_t slotIdx)
+    {
+        const cv::Mat& image = images[nextImageIdx++ % images.size()];
+
+        std::memcpy(ring->getSlot(slotIdx), image.data, image.total() * image.elemSize());
+
+        const ClassifyRequest request{nextRequestId++, slotIdx, static_cast<uint32_t>(image.rows), static_cast<uint32_t>(image.cols)};
+
+        sendTimes[slotIdx] = std::chrono::steady_clock::now();
+
+        return SendMessage(socketFd, &request, sizeof(request));
+    };
+
+    size_t inFlight = 0;
+
+    for (uint32_t slotIdx = 0; slotIdx < options.pipelineDepth && sendRequest(slotIdx); slotIdx++)
+    {
+        inFlight++;
+    }
+
+    ClassifyResponse response{};
+
+    while (inFlight > 0 && ReceiveMessage(socketFd, &response, sizeof(response)))
+    {
+        const auto receiveTime = std::chrono::steady_clock::now();
+
+        if (response.slotIdx >= sendTimes.size())
+        {
+            std::cerr << "Invalid response slot: " << response.slotIdx << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        inFlight--;
+        result.responses++;
+        result.latenciesUs.push_back(std::chrono::duration<double, std::micro>(receiveTime - sendTimes[response.slotIdx]).count());
+
+        if (response.status != ResponseStatus::Ok)
+        {
+            result.failures++;
+        }
+
+        // After the deadline the outstanding requests are only drained
+        if (receiveTime < deadline && sendRequest(response.slotIdx))
+        {
+            inFlight++;
+        }
+    }
+
+    (void)::close(socketFd);
+}
+
+int main(int argc, char* argv[])
+{
+    const LoadgenOptions options = ParseLoadgenOptions(argc, argv);
+
+    const std::vector<cv::Mat> images = LoadImages(options.imagesPath);
+
+    size_t slotSize = 0;
+
+    for (const cv::Mat& image : images)
+    {
+        slotSize = std::max(slotSize, image.total() * image.elemSize());
+    }
+
+    std::vector<ClientResult> results(options.nrOfClients);
+    std::vector<std::thread> clientThreads;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto deadline = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(options.duration);
+
+    for (size_t clientIdx = 0; clientIdx < options.nrOfClients; clientIdx++)
+    {
+        clientThreads.emplace_back(ClientThread, std::cref(options), std::cref(images), slotSize, clientIdx, deadline, std::ref(results[clientIdx]));
+    }
+
+    for (auto& clientThread : clientThreads)
+    {
+        clientThread.join();
+    }
+
+    const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    uint64_t responses = 0;
+    uint64_t failures = 0;
+    std::vector<double> latenciesUs;
+
+    for (const ClientResult& result : results)
+    {
+        responses += result.responses;
+        failures += result.failures;
+        latenciesUs.insert(latenciesUs.end(), result.latenciesUs.cbegin(), result.latenciesUs.cend());
+    }
+
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+
+    // Nearest-rank percentiles
+    auto percentile = [&latenciesUs](double fraction)
+    {
+        if (latenciesUs.empty())
+        {
+            return 0.0;
+        }
+
+        const size_t rank = static_cast<size_t>(std::ceil(fraction * latenciesUs.size()));
+
+        return latenciesUs[std::max<size_t>(rank, 1) - 1];
+    };
+
+    std::cout << "Clients: " << options.nrOfClients << " Depth: " << options.pipelineDepth << " Model: " << options.modelName << "\n"
+              << "Responses: " << responses << " Failures: " << failures << " Elapsed: " << elapsedSeconds << "s Throughput: "
+              << ((elapsedSeconds > 0.0) ? responses / elapsedSeconds : 0.0) << " requests/s\n"
+              << "Latency: p50 " << percentile(0.50) << "us, p95 " << percentile(0.95) << "us, p99 " << percentile(0.99) << "us, max "
+              << percentile(1.0) << "us\n";
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,140 @@
+#include "image_preprocessor.h"
+#include "model_handler.h"
+#include "allocation_counter.h"
+#include <benchmark/benchmark.h>
+#include <opencv2/opencv.hpp>
+#include <cstdlib>
+#include <vector>
+
+// Microbenchmarks of the preprocessing transformations and pipelines, parameterized over source resolutions.
+// Every benchmark reports the source bytes processed per second and the heap allocations per call, counted
+// by the allocation function interposition of allocation_counter.cpp.
+
+static const std::array<ChannelNormParams, 3>& kNormParams = MobileNetV2Descriptor::kChannelNormParams;
+
+static Image MakeImage(int height, int width, int type, ColorFormat fmt, MemoryLayout layout)
+{
+    cv::Mat matrix{height, width, type};
+    cv::randu(matrix, cv::Scalar::all(0), cv::Scalar::all((CV_MAT_DEPTH(type) == CV_8U) ? 256 : 1));
+
+    return Image{matrix, height, width, fmt, layout, std::string_view{}};
+}
+
+// Runs the operation on a shallow copy of the source image per iteration, the source pixels stay untouched
+template <typename Operation>
+static void RunBenchmark(benchmark::State& state, const Image& srcImage, Operation operation)
+{
+    const uint64_t startAllocationCount = GetAllocationCount();
+
+    for (auto _ : state)
+    {
+        Image img = srcImage.Borrow();
+
+        operation(img);
+
+        benchmark::DoNotOptimize(img.matrix.data);
+        benchmark::ClobberMemory();
+    }
+
+    const uint64_t allocations = GetAllocationCount() - startAllocationCount;
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * srcImage.matrix.total() * srcImage.matrix.elemSize()));
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
+static void BM_Resize(benchmark::State& state)
+{
+    const Image srcImage = MakeImage(state.range(0), state.range(1), CV_8UC3, ColorFormat::BGR, MemoryLayout::HWC);
+    const ResizeTransformation transformation{224, 224};
+
+    RunBenchmark(state, srcImage, [&transformation](Image& img) { transformation.apply(img); });
+}
+
+static void BM_ConvertColor(benchmark::State& state)
+{
+    const Image srcImage = MakeImage(state.range(0), state.range(1), CV_8UC3, ColorFormat::BGR, MemoryLayout::HWC);
+    const ConvertColorTransformation transformation{ColorFormat::RGB};
+
+    RunBenchmark(state, srcImage, [&transformation](Image& img) { transformation.apply(img); });
+}
+
+static void BM_Normalize(benchmark::State& state)
+{
+    const Image srcImage = MakeImage(state.range(0), state.range(1), CV_8UC3, ColorFormat::RGB, MemoryLayout::HWC);
+    const NormalizeTransformation transformation{kNormParams};
+
+    RunBenchmark(state, srcImage, [&transformation](Image& img) { transformation.apply(img); });
+}
+
+static void BM_ConvertMemoryLayout(benchmark::State& state)
+{
+    const Image srcImage = MakeImage(state.range(0), state.range(1), CV_32FC3, ColorFormat::RGB, MemoryLayout::HWC);
+    const ConvertMemoryLayoutTransformation transformation{MemoryLayout::CHW};
+
+    RunBenchmark(state, srcImage, [&transformation](Image& img) { transformation.apply(img); });
+}
+
+static void BM_ReferencePipeline(benchmark::State& state)
+{
+    const Image srcImage = MakeImage(state.range(0), state.range(1), CV_8UC3, ColorFormat::BGR, MemoryLayout::HWC);
+
+    MobileNetV2ModelHandler modelHandler;
+    modelHandler.BuildPreprocessPipeline(PreprocessMode::Reference);
+
+    std::vector<float> tensor(modelHandler.getInputSize());
+
+    RunBenchmark(state, srcImage, [&modelHandler, &tensor](Image& img) { modelHandler.Preprocess(img, tensor.data()); });
+}
+
+static void BM_FusedPipeline(benchmark::State& state)
+{
+    const Image srcImage = MakeImage(state.range(0), state.range(1), CV_8UC3, ColorFormat::BGR, MemoryLayout::HWC);
+
+    MobileNetV2ModelHandler modelHandler;
+    modelHandler.BuildPreprocessPipeline(PreprocessMode::Fused);
+
+    std::vector<float> tensor(modelHandler.getInputSize());
+
+    RunBenchmark(state, srcImage, [&modelHandler, &tensor](Image& img) { modelHandler.Preprocess(img, tensor.data()); });
+}
+
+static void BM_StaticPipeline(benchmark::State& state)
+{
+    const Image srcImage = MakeImage(state.range(0), state.range(1), CV_8UC3, ColorFormat::BGR, MemoryLayout::HWC);
+
+    MobileNetV2ModelHandler modelHandler;
+    modelHandler.BuildPreprocessPipeline(PreprocessMode::Static);
+
+    std::vector<float> tensor(modelHandler.getInputSize());
+
+    RunBenchmark(state, srcImage, [&modelHandler, &tensor](Image& img) { modelHandler.Preprocess(img, tensor.data()); });
+}
+
+// Source resolutions (height, width): padded, unchanged and shrunk to the 224x224 model input
+static void SourceResolutions(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->Args({160, 160})->Args({224, 224})->Args({375, 500})->Args({480, 640})->Args({1080, 1920});
+}
+
+BENCHMARK(BM_Resize)->Apply(SourceResolutions);
+BENCHMARK(BM_ConvertColor)->Apply(SourceResolutions);
+BENCHMARK(BM_Normalize)->Apply(SourceResolutions);
+BENCHMARK(BM_ConvertMemoryLayout)->Apply(SourceResolutions);
+BENCHMARK(BM_ReferencePipeline)->Apply(SourceResolutions);
+BENCHMARK(BM_FusedPipeline)->Apply(SourceResolutions);
+BENCHMARK(BM_StaticPipeline)->Apply(SourceResolutions);
+
+int main(int argc, char* argv[])
+{
+    benchmark::Initialize(&argc, argv);
+
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    return EXIT_SUCCESS;
+}
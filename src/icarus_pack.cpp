@@ -0,0 +1,134 @@
+#include "packed_dataset.h"
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <filesystem>
+
+static void PrintUsage(const char* const programName)
+{
+    std::cout << "Usage: " << programName << " [--raw] <image directory> <pack file>\n"
+              << "  --raw    Store decoded 8 bit BGR frames instead of the encoded files\n";
+}
+
+int main(int argc, char* argv[])
+{
+    PackPayload payload{PackPayload::Encoded};
+    std::vector<std::string> positionalArgs;
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        const std::string arg{argv[argIdx]};
+
+        if (arg == "--raw")
+        {
+            payload = PackPayload::RawBGR;
+        }
+        else if (arg == "--help")
+        {
+            PrintUsage(argv[0]);
+
+            return EXIT_SUCCESS;
+        }
+        else
+        {
+            positionalArgs.push_back(arg);
+        }
+    }
+
+    if (positionalArgs.size() != 2)
+    {
+        PrintUsage(argv[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::filesystem::path> imageEntries;
+
+    for (const auto& imageEntry : std::filesystem::directory_iterator{positionalArgs[0]})
+    {
+        if (imageEntry.is_regular_file())
+        {
+            imageEntries.push_back(imageEntry.path());
+        }
+    }
+
+    // Deterministic pack order, independent of the directory enumeration order
+    std::sort(imageEntries.begin(), imageEntries.end());
+
+    PackedDatasetWriter writer{positionalArgs[1], payload};
+    std::vector<uchar> encodedImage;
+    size_t nrOfSkipped = 0;
+
+    for (const auto& imagePath : imageEntries)
+    {
+        std::ifstream ifstrm{imagePath, std::ios::in | std::ios::binary};
+
+        if (!ifstrm.is_open())
+        {
+            std::cerr << "Could not open file: " << imagePath << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        encodedImage.assign(std::istreambuf_iterator<char>{ifstrm}, std::istreambuf_iterator<char>{});
+
+        if (ifstrm.bad())
+        {
+            std::cerr << "Could not read file: " << imagePath << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        // The reader rejects empty entries, and files that are no images would only fail once they are streamed
+        cv::Mat imageBGR = encodedImage.empty() ? cv::Mat{} : cv::imdecode(cv::Mat{encodedImage}, cv::ImreadModes::IMREAD_COLOR);
+
+        if (imageBGR.empty())
+        {
+            std::cerr << "Skipping " << (encodedImage.empty() ? "empty file: " : "file that cannot be decoded: ") << imagePath << std::endl;
+            nrOfSkipped++;
+
+            continue;
+        }
+
+        std::error_code errorCode;
+        const auto modificationTime = std::filesystem::last_write_time(imagePath, errorCode);
+        const int64_t modificationTimeCount = errorCode ? 0 : static_cast<int64_t>(modificationTime.time_since_epoch().count());
+
+        if (payload == PackPayload::Encoded)
+        {
+            writer.Add(imagePath.string(), encodedImage.data(), encodedImage.size(), 0, 0, modificationTimeCount);
+            continue;
+        }
+
+        // Rows are stored without padding
+        if (!imageBGR.isContinuous())
+        {
+            imageBGR = imageBGR.clone();
+        }
+
+        writer.Add(imagePath.string(), imageBGR.data, imageBGR.total() * imageBGR.elemSize(), static_cast<uint32_t>(imageBGR.rows),
+                   static_cast<uint32_t>(imageBGR.cols), modificationTimeCount);
+    }
+
+    // The reader rejects packs without entries
+    if (writer.size() == 0)
+    {
+        std::cerr << "No images to pack in " << positionalArgs[0] << std::endl;
+
+        std::error_code errorCode;
+        std::filesystem::remove(positionalArgs[1], errorCode);
+
+        return EXIT_FAILURE;
+    }
+
+    writer.Finish();
+
+    std::cout << "Packed " << writer.size() << " images into " << positionalArgs[1] << ", skipped " << nrOfSkipped << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,331 @@
+#include "runtime.h"
+#include "model_handler.h"
+#include "postprocessor.h"
+#include "image_provider.h"
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <filesystem>
+#include <iterator>
+
+// Quantization helper: dumps preprocessed calibration tensors for the offline INT8 quantization of the model,
+// and compares the FP32 and INT8 model variants in top-1 agreement and throughput.
+
+static constexpr const char* const kImagesPath{"assets/images/"};
+static constexpr size_t kTopK{5};
+
+static void PrintUsage(const char* const programName)
+{
+    std::cout << "Usage: " << programName << " calibrate <output directory>\n"
+              << "       " << programName << " compare [--rounds <N>] [--batch-size <N>] [--json <FILE>]\n"
+              << "  calibrate           Write the preprocessed tensor of every image in " << kImagesPath << " as raw float32 NCHW file\n"
+              << "  compare             Run all images through the FP32 and the INT8 model and report top-1 agreement and images/s\n"
+              << "  --rounds <N>        Passes over the images for the throughput measurement (default: 10)\n"
+              << "  --batch-size <N>    Images per inference call (default: 8)\n"
+              << "  --json <FILE>       Write the comparison as JSON to FILE\n";
+}
+
+static long long ParseInteger(const std::string& option, const char* const value, long long minValue)
+{
+    char* end = nullptr;
+    long long parsedValue = std::strtoll(value, &end, 10);
+
+    if (end == value || *end != '\0' || parsedValue < minValue)
+    {
+        std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return parsedValue;
+}
+
+static std::vector<std::filesystem::path> ListImages()
+{
+    std::vector<std::filesystem::path> imagePaths;
+
+    for (const auto& imageEntry : std::filesystem::directory_iterator{kImagesPath})
+    {
+        if (imageEntry.is_regular_file())
+        {
+            imagePaths.push_back(imageEntry.path());
+        }
+    }
+
+    std::sort(imagePaths.begin(), imagePaths.end());
+
+    return imagePaths;
+}
+
+// Preprocessed input tensors of all images, back to back
+static std::vector<float> PreprocessImages(ModelHandler& modelHandler, const std::vector<std::filesystem::path>& imagePaths)
+{
+    const size_t inputSize = static_cast<size_t>(modelHandler.getInputSize());
+
+    std::vector<float> tensors(imagePaths.size() * inputSize);
+
+    for (size_t imageIdx = 0; imageIdx < imagePaths.size(); imageIdx++)
+    {
+        cv::Mat imageBGR = cv::imread(imagePaths[imageIdx].string(), cv::ImreadModes::IMREAD_COLOR);
+
+        if (imageBGR.empty())
+        {
+            std::cerr << "Could not decode image: " << imagePaths[imageIdx] << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        Image img{imageBGR, imageBGR.rows, imageBGR.cols, ColorFormat::BGR, MemoryLayout::HWC, imagePaths[imageIdx].native()};
+
+        modelHandler.Preprocess(img, tensors.data() + imageIdx * inputSize);
+    }
+
+    return tensors;
+}
+
+static int Calibrate(const std::filesystem::path& outputPath)
+{
+    MobileNetV2ModelHandler modelHandler;
+    modelHandler.BuildPreprocessPipeline(PreprocessMode::Reference);
+
+    const std::vector<std::filesystem::path> imagePaths = ListImages();
+    const std::vector<float> tensors = PreprocessImages(modelHandler, imagePaths);
+    const size_t inputSize = static_cast<size_t>(modelHandler.getInputSize());
+
+    std::filesystem::create_directories(outputPath);
+
+    // The manifest lists the tensor shape and files, e.g. for a CalibrationDataReader reading them with numpy.fromfile
+    std::ofstream manifest{outputPath / "calibration.txt", std::ios::out | std::ios::trunc};
+
+    if (!manifest.is_open())
+    {
+        std::cerr << "Could not open file: " << outputPath / "calibration.txt" << std::endl;
+
+        return EXIT_FAILURE;
+    }
+
+    manifest << "shape 1 " << modelHandler.getInputChannels() << " " << modelHandler.getInputHeight() << " " << modelHandler.getInputWidth() << " float32\n";
+
+    for (size_t imageIdx = 0; imageIdx < imagePaths.size(); imageIdx++)
+    {
+        const std::string tensorFileName = std::to_string(imageIdx) + ".raw";
+
+        std::ofstream ofstrm{outputPath / tensorFileName, std::ios::out | std::ios::binary | std::ios::trunc};
+
+        ofstrm.write(reinterpret_cast<const char*>(tensors.data() + imageIdx * inputSize), inputSize * sizeof(float));
+
+        if (!ofstrm.good())
+        {
+            std::cerr << "Could not write file: " << outputPath / tensorFileName << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        manifest << tensorFileName << " " << imagePaths[imageIdx].filename().string() << "\n";
+    }
+
+    std::cout << "Wrote " << imagePaths.size() << " calibration tensors to " << outputPath << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+struct VariantResult
+{
+    std::vector<Prediction> predictions;
+    double imagesPerSecond;
+};
+
+static VariantResult RunVariant(Ort::Env& env, ModelPrecision precision, const std::vector<float>& tensors, size_t nrOfImages, int64_t batchSize, size_t nrOfRounds)
+{
+    MobileNetV2ModelHandler modelHandler{batchSize, precision};
+    modelHandler.BuildPostprocessor(kTopK);
+
+    Runtime runtime{env};
+    runtime.Prepare(modelHandler.getModelPath(), modelHandler.getInputBatches(), 1, std::max(1u, std::thread::hardware_concurrency()));
+
+    const size_t inputSize = static_cast<size_t>(modelHandler.getInputSize());
+    const size_t maxBatchSize = static_cast<size_t>(runtime.getMaxBatchSize());
+
+    RuntimeSlot& slot = runtime.getSlot(0);
+
+    VariantResult result;
+    result.predictions.reserve(nrOfImages);
+
+    std::vector<Prediction> batchPredictions;
+    std::chrono::steady_clock::duration inferenceTime{0};
+
+    for (size_t roundIdx = 0; roundIdx < nrOfRounds; roundIdx++)
+    {
+        for (size_t firstImageIdx = 0; firstImageIdx < nrOfImages; firstImageIdx += maxBatchSize)
+        {
+            const size_t nrOfBatchImages = std::min(maxBatchSize, nrOfImages - firstImageIdx);
+
+            std::copy_n(tensors.data() + firstImageIdx * inputSize, nrOfBatchImages * inputSize, slot.getInputData());
+
+            const auto inferenceStartTime = std::chrono::steady_clock::now();
+            runtime.Execute(0, nrOfBatchImages);
+            inferenceTime += std::chrono::steady_clock::now() - inferenceStartTime;
+
+            if (roundIdx == 0)
+            {
+                modelHandler.Postprocess(slot.getOutputData(), nrOfBatchImages, batchPredictions);
+
+                std::move(batchPredictions.begin(), batchPredictions.begin() + nrOfBatchImages, std::back_inserter(result.predictions));
+            }
+        }
+    }
+
+    const double inferenceSeconds = std::chrono::duration<double>(inferenceTime).count();
+
+    result.imagesPerSecond = (inferenceSeconds > 0.0) ? (nrOfImages * nrOfRounds) / inferenceSeconds : 0.0;
+
+    // Labels are owned by the model handler going out of scope, only indices and probabilities are used further on
+    for (Prediction& prediction : result.predictions)
+    {
+        for (ClassScore& classScore : prediction)
+        {
+            classScore.label = std::string_view{};
+        }
+    }
+
+    return result;
+}
+
+static int Compare(size_t nrOfRounds, int64_t batchSize, const std::string& jsonPath)
+{
+    MobileNetV2ModelHandler preprocessHandler;
+    preprocessHandler.BuildPreprocessPipeline(PreprocessMode::Reference);
+
+    const std::vector<std::filesystem::path> imagePaths = ListImages();
+    const std::vector<float> tensors = PreprocessImages(preprocessHandler, imagePaths);
+
+    Ort::Env env{ORT_LOGGING_LEVEL_WARNING, "Icarus_quant"};
+
+    const VariantResult fp32Result = RunVariant(env, ModelPrecision::FP32, tensors, imagePaths.size(), batchSize, nrOfRounds);
+    const VariantResult int8Result = RunVariant(env, ModelPrecision::INT8, tensors, imagePaths.size(), batchSize, nrOfRounds);
+
+    size_t top1Agreements = 0;
+    size_t top1InTop5 = 0;
+
+    for (size_t imageIdx = 0; imageIdx < imagePaths.size(); imageIdx++)
+    {
+        const Prediction& fp32Prediction = fp32Result.predictions[imageIdx];
+        const Prediction& int8Prediction = int8Result.predictions[imageIdx];
+
+        if (fp32Prediction.empty() || int8Prediction.empty())
+        {
+            continue;
+        }
+
+        const size_t fp32ClassIdx = fp32Prediction.front().classIdx;
+
+        top1Agreements += (int8Prediction.front().classIdx == fp32ClassIdx) ? 1 : 0;
+        top1InTop5 += std::any_of(int8Prediction.cbegin(), int8Prediction.cend(), [fp32ClassIdx](const ClassScore& classScore)
+        {
+            return classScore.classIdx == fp32ClassIdx;
+        }) ? 1 : 0;
+    }
+
+    const double nrOfImages = static_cast<double>(std::max<size_t>(imagePaths.size(), 1));
+    const double top1Agreement = top1Agreements / nrOfImages;
+    const double top5Containment = top1InTop5 / nrOfImages;
+    const double speedup = (fp32Result.imagesPerSecond > 0.0) ? int8Result.imagesPerSecond / fp32Result.imagesPerSecond : 0.0;
+
+    std::cout << "Images: " << imagePaths.size() << " Rounds: " << nrOfRounds << " Batch size: " << batchSize << "\n"
+              << "FP32: " << fp32Result.imagesPerSecond << " images/s\n"
+              << "INT8: " << int8Result.imagesPerSecond << " images/s (speedup " << speedup << "x)\n"
+              << "Top-1 agreement: " << top1Agreement * 100.0 << "%\n"
+              << "FP32 top-1 within INT8 top-" << kTopK << ": " << top5Containment * 100.0 << "%\n";
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream ofstrm{jsonPath, std::ios::out | std::ios::trunc};
+
+        if (!ofstrm.is_open())
+        {
+            std::cerr << "Could not open file: " << jsonPath << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        ofstrm << "{\n"
+               << "  \"images\": " << imagePaths.size() << ",\n"
+               << "  \"rounds\": " << nrOfRounds << ",\n"
+               << "  \"batch_size\": " << batchSize << ",\n"
+               << "  \"fp32_images_per_s\": " << fp32Result.imagesPerSecond << ",\n"
+               << "  \"int8_images_per_s\": " << int8Result.imagesPerSecond << ",\n"
+               << "  \"top1_agreement\": " << top1Agreement << ",\n"
+               << "  \"top1_in_top5\": " << top5Containment << "\n"
+               << "}\n";
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        PrintUsage(argv[0]);
+
+        return EXIT_FAILURE;
+    }
+
+    const std::string command{argv[1]};
+
+    if (command == "calibrate" && argc == 3)
+    {
+        return Calibrate(argv[2]);
+    }
+    else if (command == "compare")
+    {
+        size_t nrOfRounds = 10;
+        int64_t batchSize = 8;
+        std::string jsonPath;
+
+        for (int argIdx = 2; argIdx + 1 < argc; argIdx += 2)
+        {
+            const std::string option{argv[argIdx]};
+
+            if (option == "--rounds")
+            {
+                nrOfRounds = ParseInteger(option, argv[argIdx + 1], 1);
+            }
+            else if (option == "--batch-size")
+            {
+                batchSize = ParseInteger(option, argv[argIdx + 1], 1);
+            }
+            else if (option == "--json")
+            {
+                jsonPath = argv[argIdx + 1];
+            }
+            else
+            {
+                std::cerr << "Unknown option: " << option << std::endl;
+                PrintUsage(argv[0]);
+
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (argc % 2 != 0)
+        {
+            std::cerr << "Missing value for option: " << argv[argc - 1] << std::endl;
+
+            return EXIT_FAILURE;
+        }
+
+        return Compare(nrOfRounds, batchSize, jsonPath);
+    }
+
+    PrintUsage(argv[0]);
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,531 @@
+#include "config.h"
+#include "fair_scheduler.h"
+#include "ipc_protocol.h"
+#include "model_registry.h"
+#include "model_handler.h"
+#include "postprocessor.h"
+#include "runtime.h"
+#include "shared_frame_ring.h"
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <csignal>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Classification server for other processes on the same host. Clients connect to a Unix domain socket, pass the
+// file descriptor of their SharedFrameRing and then pipeline requests referring to frames in the ring. Requests are
+// queued per model and batched by the same FairScheduler, ModelHandler and Runtime path Icarus uses.
+
+struct ServerOptions
+{
+    std::string socketPath{kDefaultSocketPath};
+};
+
+// A connected client. Queued requests keep it alive, so its ring stays mapped until their responses were sent.
+struct ClientConnection
+{
+    int socketFd;
+    std::unique_ptr<SharedFrameRing> ring;
+    // Index into the served models, which is also the queue index of the scheduler
+    size_t modelQueueIdx{0};
+    // Responses of different workers to the same client must not interleave
+    std::mutex mtxSend;
+    // Requests queued or being classified, at most as many as the ring has slots
+    std::atomic<uint32_t> inFlight{0};
+    std::atomic<bool> disconnected{false};
+    std::atomic<bool> finished{false};
+
+    explicit ClientConnection(int fd) : socketFd{fd} {}
+    ~ClientConnection() { (void)::close(socketFd); }
+
+    // Never blocks the calling worker. With the requests in flight bounded, the responses of a client that reads them fit
+    // into its socket buffer, so a full buffer means the client stopped reading and it is disconnected.
+    void Respond(const ClassifyResponse& response)
+    {
+        std::lock_guard<std::mutex> lgSend{mtxSend};
+
+        if (disconnected)
+        {
+            return;
+        }
+
+        if (!SendMessage(socketFd, &response, sizeof(response), MSG_DONTWAIT))
+        {
+            disconnected = true;
+
+            // Ends the receive loop of the connection thread
+            (void)::shutdown(socketFd, SHUT_RDWR);
+        }
+    }
+};
+
+struct ServerRequest
+{
+    // Frame wrapped in place in the client's ring
+    Image img;
+    std::shared_ptr<ClientConnection> client;
+    uint64_t requestId{0};
+    uint32_t slotIdx{0};
+};
+
+std::unique_ptr<FairScheduler<ServerRequest>> requestScheduler;
+
+std::atomic<uint64_t> servedRequests{0};
+std::atomic<uint64_t> invalidRequests{0};
+std::atomic<uint64_t> rejectedRequests{0};
+std::atomic<bool> terminating{false};
+
+static void PrintUsage(const char* const programName)
+{
+    std::cout << "Usage: " << programName << " [server options] [Icarus options]\n"
+              << "  --socket <PATH>      Unix domain socket the server listens on (default: " << kDefaultSocketPath << ")\n"
+              << "Models, workers, batch size, queue and preprocessing options are shared with Icarus, see Icarus --help\n";
+}
+
+// Extracts the server options, all other arguments are left for ParseCommandLine
+static ServerOptions ParseServerOptions(int argc, char* argv[], std::vector<char*>& remainingArgs)
+{
+    ServerOptions serverOptions;
+
+    remainingArgs.push_back(argv[0]);
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        const std::string option{argv[argIdx]};
+
+        if (option == "--help")
+        {
+            PrintUsage(argv[0]);
+
+            std::exit(EXIT_SUCCESS);
+        }
+
+        if (option != "--socket")
+        {
+            remainingArgs.push_back(argv[argIdx]);
+            continue;
+        }
+
+        if (argIdx + 1 >= argc)
+        {
+            std::cerr << "Missing value for option: " << option << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        serverOptions.socketPath = argv[++argIdx];
+    }
+
+    return serverOptions;
+}
+
+static ClassifyResponse MakeResponse(uint64_t requestId, uint32_t slotIdx, ResponseStatus status)
+{
+    ClassifyResponse response{};
+
+    response.requestId = requestId;
+    response.slotIdx = slotIdx;
+    response.status = status;
+
+    return response;
+}
+
+// Reads the requests of one client until it disconnects or the server shuts down
+void ConnectionThread(std::shared_ptr<ClientConnection> client, const std::vector<std::string>& modelNames, uint32_t topK)
+{
+    HelloRequest hello{};
+    int ringFd = -1;
+
+    if (!ReceiveMessageWithFd(client->socketFd, &hello, sizeof(hello), ringFd))
+    {
+        client->finished = true;
+
+        return;
+    }
+
+    HelloResponse helloResponse{ResponseStatus::Ok, topK};
+
+    hello.modelName.back() = '\0';
+
+    auto modelIt = std::find(modelNames.cbegin(), modelNames.cend(), std::string{hello.modelName.data()});
+
+    // The ring is bounded before it is mapped, a client cannot make the server map an arbitrary amount of memory
+    const bool validRing = (hello.nrOfSlots > 0 && hello.nrOfSlots <= kMaxRingSlots && hello.slotSize > 0 &&
+                            static_cast<uint64_t>(hello.nrOfSlots) * hello.slotSize <= kMaxRingSize);
+
+    if (hello.magic != kProtocolMagic || hello.version != kProtocolVersion || ringFd < 0 || !validRing)
+    {
+        helloResponse.status = ResponseStatus::InvalidRequest;
+    }
+    else if (modelIt == modelNames.cend())
+    {
+        helloResponse.status = ResponseStatus::UnknownModel;
+    }
+    else
+    {
+        client->ring = SharedFrameRing::Attach(ringFd, hello.nrOfSlots, hello.slotSize);
+        client->modelQueueIdx = static_cast<size_t>(modelIt - modelNames.cbegin());
+        ringFd = -1;
+
+        if (client->ring == nullptr)
+        {
+            helloResponse.status = ResponseStatus::InvalidRequest;
+        }
+    }
+
+    if (ringFd >= 0)
+    {
+        (void)::close(ringFd);
+    }
+
+    if (!SendMessage(client->socketFd, &helloResponse, sizeof(helloResponse)) || helloResponse.status != ResponseStatus::Ok)
+    {
+        client->finished = true;
+
+        return;
+    }
+
+    ClassifyRequest request{};
+
+    while (ReceiveMessage(client->socketFd, &request, sizeof(request)))
+    {
+        // Dimensions are bounded before they are multiplied, so the frame size cannot wrap around
+        const bool validSize = (request.height > 0 && request.width > 0 && request.height <= kMaxFrameDimension && request.width <= kMaxFrameDimension &&
+                                static_cast<size_t>(request.height) * request.width * 3 <= client->ring->getSlotSize());
+
+        if (request.slotIdx >= client->ring->getNrOfSlots() || !validSize)
+        {
+            invalidRequests.fetch_add(1, std::memory_order_relaxed);
+            client->Respond(MakeResponse(request.requestId, request.slotIdx, ResponseStatus::InvalidRequest));
+            continue;
+        }
+
+        // Only this thread adds requests, hence the count cannot exceed the limit between the check and the increment
+        if (client->inFlight.load(std::memory_order_acquire) >= client->ring->getNrOfSlots())
+        {
+            rejectedRequests.fetch_add(1, std::memory_order_relaxed);
+            client->Respond(MakeResponse(request.requestId, request.slotIdx, ResponseStatus::TooManyRequests));
+            continue;
+        }
+
+        client->inFlight.fetch_add(1, std::memory_order_acq_rel);
+
+        ServerRequest serverRequest;
+
+        serverRequest.img.matrix = cv::Mat(static_cast<int>(request.height), static_cast<int>(request.width), CV_8UC3, client->ring->getSlot(request.slotIdx));
+        serverRequest.img.height = static_cast<int>(request.height);
+        serverRequest.img.width = static_cast<int>(request.width);
+        serverRequest.img.fmt = ColorFormat::BGR;
+        serverRequest.img.layout = MemoryLayout::HWC;
+        serverRequest.img.sequenceNr = request.requestId;
+        serverRequest.img.trace.captureEnd = std::chrono::steady_clock::now();
+        serverRequest.client = client;
+        serverRequest.requestId = request.requestId;
+        serverRequest.slotIdx = request.slotIdx;
+
+        // Blocks while the queue of the model is full, which stops reading from the socket and backpressures the client
+        (void)requestScheduler->push(client->modelQueueIdx, std::move(serverRequest));
+    }
+
+    client->finished = true;
+}
+
+// Handler and single runtime slot of one model within a worker
+struct ServerModel
+{
+    std::unique_ptr<ModelHandler> modelHandler_;
+    std::unique_ptr<Runtime> runtime_;
+};
+
+void WorkerThread(Config config, std::vector<ServerModel>& models)
+{
+    std::vector<size_t> maxBatchSizes;
+
+    for (const auto& model : models)
+    {
+        maxBatchSizes.push_back(static_cast<size_t>(model.runtime_->getMaxBatchSize()));
+    }
+
+    std::vector<ServerRequest> batch;
+    batch.reserve(*std::max_element(maxBatchSizes.cbegin(), maxBatchSizes.cend()));
+
+    std::vector<Prediction> predictions;
+
+    while (true)
+    {
+        std::optional<size_t> modelIdx = requestScheduler->popBatch(batch, maxBatchSizes, config.maxBatchDelay);
+
+        if (!modelIdx.has_value())
+        {
+            break;
+        }
+
+        ModelHandler& modelHandler = *models[*modelIdx].modelHandler_;
+        Runtime& runtime = *models[*modelIdx].runtime_;
+        RuntimeSlot& slot = runtime.getSlot(0);
+
+        const int64_t inputSize = modelHandler.getInputSize();
+        const int64_t frameSize = modelHandler.getInputHeight() * modelHandler.getInputWidth() * 3;
+
+        for (size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++)
+        {
+            // Transformations replace the matrix, the frame in the client's ring is only read
+            Image& img = batch[batchIdx].img;
+
+            if (config.preprocessMode == PreprocessMode::InGraph)
+            {
+                modelHandler.PreprocessFrame(img, slot.getFrameData() + batchIdx * frameSize);
+            }
+            else
+            {
+                modelHandler.Preprocess(img, slot.getInputData() + batchIdx * inputSize);
+            }
+        }
+
+        runtime.Execute(0, batch.size());
+
+        modelHandler.Postprocess(slot.getOutputData(), batch.size(), predictions);
+
+        for (size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++)
+        {
+            ServerRequest& request = batch[batchIdx];
+
+            ClassifyResponse response = MakeResponse(request.requestId, request.slotIdx, ResponseStatus::Ok);
+
+            for (const ClassScore& classScore : predictions[batchIdx])
+            {
+                response.classIdxs[response.nrOfScores] = static_cast<uint32_t>(classScore.classIdx);
+                response.probabilities[response.nrOfScores] = classScore.probability;
+                response.nrOfScores++;
+            }
+
+            // Released before responding, a client may reuse the slot as soon as the response arrived
+            request.client->inFlight.fetch_sub(1, std::memory_order_acq_rel);
+            request.client->Respond(response);
+        }
+
+        servedRequests.fetch_add(batch.size(), std::memory_order_relaxed);
+
+        // Releases the connections, the ring of a disconnected client is unmapped with its last request
+        batch.clear();
+    }
+}
+
+static int Listen(const std::string& socketPath)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long: " << socketPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    // A socket file left behind by a previous run would make bind() fail
+    (void)::unlink(socketPath.c_str());
+
+    const int listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (listenFd < 0 || ::bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenFd, SOMAXCONN) != 0)
+    {
+        std::cerr << "Could not listen on socket: " << socketPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    return listenFd;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<char*> remainingArgs;
+
+    const ServerOptions serverOptions = ParseServerOptions(argc, argv, remainingArgs);
+    const Config config = ParseCommandLine(static_cast<int>(remainingArgs.size()), remainingArgs.data());
+
+    // SIGINT and SIGTERM are taken by sigwait() below, all threads inherit the mask
+    sigset_t terminationSignals;
+    sigemptyset(&terminationSignals);
+    sigaddset(&terminationSignals, SIGINT);
+    sigaddset(&terminationSignals, SIGTERM);
+    (void)::pthread_sigmask(SIG_BLOCK, &terminationSignals, nullptr);
+
+    ModelRegistry registry{static_cast<int>(config.intraOpThreads), 1, config.placement.onnxRuntime};
+
+    RegisterBuiltinModels(registry);
+
+    for (const std::string& modelName : config.modelNames)
+    {
+        if (!registry.Find(modelName).has_value())
+        {
+            std::cerr << "Unknown model: " << modelName << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    requestScheduler = std::make_unique<FairScheduler<ServerRequest>>(config.modelNames.size(), config.inputQueueCapacity, OverflowPolicy::Block);
+
+    // Every worker holds a session per served model, created through the registry's shared environment
+    std::vector<std::vector<ServerModel>> workerModels(config.nrOfWorkers);
+
+    for (size_t workerIdx = 0; workerIdx < workerModels.size(); workerIdx++)
+    {
+        std::vector<ServerModel>& models = workerModels[workerIdx];
+
+        // Workers run all stages on one thread, which takes the inference placement
+        ScopedThreadPlacement placement{SelectCpuList(config.placement.inference, workerIdx)};
+
+        for (const std::string& modelName : config.modelNames)
+        {
+            const size_t modelIdx = *registry.Find(modelName);
+
+            ServerModel model{registry.CreateHandler(modelIdx, config.maxBatchSize), registry.CreateRuntime()};
+
+            model.modelHandler_->BuildPreprocessPipeline(config.preprocessMode);
+            model.modelHandler_->BuildPostprocessor(config.topK);
+
+            std::optional<InGraphPreprocessing> inGraphPreprocessing;
+
+            if (config.preprocessMode == PreprocessMode::InGraph)
+            {
+                inGraphPreprocessing = model.modelHandler_->getInGraphPreprocessing();
+            }
+
+            model.runtime_->Prepare(model.modelHandler_->getModelPath(), model.modelHandler_->getInputBatches(), 1, registry.getIntraOpThreads(), inGraphPreprocessing,
+                                    RuntimeStartupOptions{config.modelCacheDir, config.warmupRuns});
+
+            std::cout << modelName << " ";
+            model.runtime_->PrintStartupStats();
+
+            models.push_back(std::move(model));
+        }
+    }
+
+    std::vector<std::thread> workerThreads;
+
+    for (size_t workerIdx = 0; workerIdx < workerModels.size(); workerIdx++)
+    {
+        ScopedThreadPlacement placement{SelectCpuList(config.placement.inference, workerIdx)};
+
+        workerThreads.emplace_back(WorkerThread, config, std::ref(workerModels[workerIdx]));
+    }
+
+    const int listenFd = Listen(serverOptions.socketPath);
+
+    // Shutting the listening socket down makes accept() return, which ends the accept loop
+    std::thread signalThread{[&terminationSignals, listenFd]()
+    {
+        int signal = 0;
+
+        (void)::sigwait(&terminationSignals, &signal);
+
+        terminating = true;
+        (void)::shutdown(listenFd, SHUT_RDWR);
+    }};
+
+    std::cout << "Listening on " << serverOptions.socketPath << " Workers: " << config.nrOfWorkers << " Models:";
+
+    for (const std::string& modelName : config.modelNames)
+    {
+        std::cout << " " << modelName;
+    }
+
+    std::cout << std::endl;
+
+    std::vector<std::pair<std::thread, std::shared_ptr<ClientConnection>>> connections;
+
+    while (true)
+    {
+        const int clientFd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if (clientFd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        // Threads of clients that disconnected are joined as new clients arrive
+        auto finishedIt = std::partition(connections.begin(), connections.end(), [](const auto& connection) { return !connection.second->finished; });
+
+        for (auto it = finishedIt; it != connections.end(); it++)
+        {
+            it->first.join();
+        }
+
+        connections.erase(finishedIt, connections.end());
+
+        auto client = std::make_shared<ClientConnection>(clientFd);
+
+        connections.emplace_back(std::thread{ConnectionThread, client, std::cref(config.modelNames), static_cast<uint32_t>(config.topK)}, client);
+    }
+
+    // The signal thread still waits if accepting failed for another reason
+    if (!terminating)
+    {
+        std::cerr << "Could not accept connections: " << std::strerror(errno) << std::endl;
+
+        (void)::kill(::getpid(), SIGTERM);
+    }
+
+    signalThread.join();
+
+    std::cout << "Shutting down" << std::endl;
+
+    // Stops reading requests, responses to the requests already queued are still sent
+    for (auto& connection : connections)
+    {
+        (void)::shutdown(connection.second->socketFd, SHUT_RD);
+        connection.first.join();
+    }
+
+    connections.clear();
+
+    requestScheduler->close();
+
+    for (auto& workerThread : workerThreads)
+    {
+        workerThread.join();
+    }
+
+    (void)::close(listenFd);
+    (void)::unlink(serverOptions.socketPath.c_str());
+
+    std::cout << "Served requests: " << servedRequests.load() << ", invalid requests: " << invalidRequests.load()
+              << ", rejected requests: " << rejectedRequests.load() << "\n";
+
+    for (size_t queueIdx = 0; queueIdx < config.modelNames.size(); queueIdx++)
+    {
+        const QueueStats stats = requestScheduler->getStats(queueIdx);
+
+        std::cout << "Request queue " << config.modelNames[queueIdx] << ": pushed " << stats.pushed << ", popped " << stats.popped
+                  << ", peak occupancy " << stats.peakOccupancy << "/" << stats.capacity << "\n";
+    }
+
+    requestScheduler.reset();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include "frame_pool.h"
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+enum class ColorFormat : uint8_t
+{
+    RGB = 0,
+    BGR = 1
+};
+
+enum class MemoryLayout : uint8_t
+{
+    HWC = 0,
+    CHW = 1
+};
+
+// Points in time a frame passed through the pipeline stages, stages not passed are left at the epoch
+struct FrameTrace
+{
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    TimePoint captureStart;
+    TimePoint decodeStart;
+    TimePoint decodeEnd;
+    // Handed over to the input queue
+    TimePoint captureEnd;
+    TimePoint preprocessStart;
+    TimePoint preprocessEnd;
+    TimePoint inferenceStart;
+    TimePoint inferenceEnd;
+    TimePoint postprocessEnd;
+    TimePoint displayed;
+};
+
+struct Image
+{
+    cv::Mat matrix;
+    int height;
+    int  width;
+    ColorFormat fmt;
+    MemoryLayout layout;
+    // Refers to the image list, the pack names or the video path of the frame source, which outlive all images
+    std::string_view path;
+    // Capture order of the image, used to restore the order of results produced by concurrent workers
+    uint64_t sequenceNr{0};
+    // Version of the source file, 0 if the image does not originate from a file of its own (e.g. video frames)
+    int64_t modificationTime{0};
+    uintmax_t fileSize{0};
+    FrameTrace trace;
+    // Latest point in time the result is still of use (capture time plus the end-to-end latency objective), the epoch means no deadline
+    std::chrono::steady_clock::time_point deadline;
+    // Pooled storage of the pixels, empty if the matrix owns its pixels or only references them
+    FrameHandle frame;
+
+    // Copy sharing the pixels without taking over the pooled frame, which stays owned by this image.
+    // Transformations replace the matrix of the copy, the pixels of this image are left untouched.
+    Image Borrow() const { return Image{matrix, height, width, fmt, layout, path, sequenceNr, modificationTime, fileSize, trace, deadline}; }
+};
+
+#endif // #ifndef IMAGE_H_
@@ -1,25 +1,31 @@
 #include "image_preprocessor.h"
+#include "fused_preprocessor.h"
 #include <opencv2/dnn/dnn.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <cmath>
 #include <algorithm>
 
 void ResizeTransformation::resize(Image& image, int height, int width) const
 {
-    if ((height > image.height && width < image.width) || (height < image.height && width > image.width))
+    if (height == image.height && width == image.width)
     {
-        std::cerr << "Shrinking/Enlarging per dimension is not supported!\n";
-
-        std::exit(EXIT_FAILURE);
+        return;
     }
 
-    if (height == image.height && width == image.width)
+    // Dimensions exceeding the target are shrunk, dimensions falling short of it are padded afterwards,
+    // which also covers images larger than the target in one dimension and smaller in the other
+    const int shrunkHeight = std::min(height, image.height);
+    const int shrunkWidth = std::min(width, image.width);
+
+    if (shrunkHeight < image.height || shrunkWidth < image.width)
     {
-        return;
+        cv::resize(image.matrix, image.matrix, cv::Size(shrunkWidth, shrunkHeight), cv::InterpolationFlags::INTER_AREA);
     }
-    else if (height > image.height)
+
+    if (height > shrunkHeight || width > shrunkWidth)
     {
-        int delta_height = height - image.height;
-        int delta_width = width - image.width;
+        int delta_height = height - shrunkHeight;
+        int delta_width = width - shrunkWidth;
 
         int borderTop = static_cast<int>(std::round(delta_height / 2.0f));
         int borderBottom = delta_height - borderTop;
@@ -29,10 +35,6 @@ void ResizeTransformation::resize(Image& image, int height, int width) const
 
         cv::copyMakeBorder(image.matrix, image.matrix, borderTop, borderBottom, borderLeft, borderRight, cv::BorderTypes::BORDER_CONSTANT, cv::Scalar{0, 0, 0});
     }
-    else // Shrink
-    {
-        cv::resize(image.matrix, image.matrix, cv::Size(width, height), cv::InterpolationFlags::INTER_AREA);
-    }
 
     image.height = image.matrix.rows;
     image.width = image.matrix.cols;
@@ -42,7 +44,10 @@ void ConvertColorTransformation::convertRGB(Image& image, ColorFormat colorFmt)
 {
     if (image.fmt == ColorFormat::BGR)
     {
-        cv::cvtColor(image.matrix, image.matrix, cv::ColorConversionCodes::COLOR_BGR2RGB);
+        // Out of place, the source pixels may be shared with the displayed copy or be a read-only mapping
+        cv::Mat imageRGB;
+        cv::cvtColor(image.matrix, imageRGB, cv::ColorConversionCodes::COLOR_BGR2RGB);
+        image.matrix = imageRGB;
         image.fmt = ColorFormat::RGB;
     }
 }
@@ -72,4 +77,66 @@ void NormalizeTransformation::normalize(Image& image, const std::array<ChannelNo
     std::transform(imageChannels.cbegin(), imageChannels.cend(), normParams.cbegin(), imageChannels.begin(), norm_fun);
     
     cv::merge(imageChannels.data(), 3, image.matrix);
-}
\ No newline at end of file
+}
+
+void ComputeAreaWeights(int srcSize, int dstSize, std::vector<ResampleWeight>& weights, std::vector<int>& offsets)
+{
+    const double scale = static_cast<double>(srcSize) / dstSize;
+
+    weights.clear();
+    offsets.clear();
+
+    for (int dstIdx = 0; dstIdx < dstSize; dstIdx++)
+    {
+        offsets.push_back(static_cast<int>(weights.size()));
+
+        const double srcBegin = dstIdx * scale;
+        const double srcEnd = srcBegin + scale;
+        const double cellSize = std::min(scale, srcSize - srcBegin);
+
+        int srcEndIdx = std::min(static_cast<int>(std::floor(srcEnd)), srcSize - 1);
+        int srcBeginIdx = std::min(static_cast<int>(std::ceil(srcBegin)), srcEndIdx);
+
+        if (srcBeginIdx - srcBegin > 1e-3)
+        {
+            weights.push_back({srcBeginIdx - 1, static_cast<float>((srcBeginIdx - srcBegin) / cellSize)});
+        }
+
+        for (int srcIdx = srcBeginIdx; srcIdx < srcEndIdx; srcIdx++)
+        {
+            weights.push_back({srcIdx, static_cast<float>(1.0 / cellSize)});
+        }
+
+        if (srcEnd - srcEndIdx > 1e-3)
+        {
+            weights.push_back({srcEndIdx, static_cast<float>(std::min(std::min(srcEnd - srcEndIdx, 1.0), cellSize) / cellSize)});
+        }
+    }
+
+    offsets.push_back(static_cast<int>(weights.size()));
+}
+
+void AccumulateRow(const uint8_t* srcRow, float rowWeight, float* accumulator, int size)
+{
+    // Vertical pass over the interleaved source row, contiguous and independent of the channel order
+    int idx = 0;
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    const int lanes = cv::VTraits<cv::v_float32>::vlanes();
+
+    const cv::v_float32 weight = cv::vx_setall_f32(rowWeight);
+
+    for (; idx <= size - lanes; idx += lanes)
+    {
+        const cv::v_float32 values = cv::v_cvt_f32(cv::v_reinterpret_as_s32(cv::vx_load_expand_q(srcRow + idx)));
+
+        cv::v_store(accumulator + idx, cv::v_fma(values, weight, cv::vx_load(accumulator + idx)));
+    }
+#endif
+
+    for (; idx < size; idx++)
+    {
+        accumulator[idx] += rowWeight * srcRow[idx];
+    }
+}
+
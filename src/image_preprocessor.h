@@ -1,9 +1,11 @@
 #ifndef IMAGE_PREPROCESSOR_H_
 #define IMAGE_PREPROCESSOR_H_
 
-#include "image_provider.h"
+#include "image.h"
 #include <memory>
 #include <vector>
+#include <array>
+#include <cstdint>
 
 struct ChannelNormParams
 {
@@ -11,6 +13,16 @@ struct ChannelNormParams
     float std;
 };
 
+enum class PreprocessMode : uint8_t
+{
+    Reference = 0,
+    Fused = 1,
+    // Fused kernel specialized at compile time from the model descriptor, see static_pipeline.h
+    Static = 2,
+    // Only resizing on the CPU, color conversion, normalization and layout conversion run inside ONNX Runtime on 8 bit frames
+    InGraph = 3
+};
+
 class ImageTransformation
 {
     public:
@@ -138,4 +150,14 @@ class ImagePreprocessingPipelineBuilder
     std::unique_ptr<ImagePreprocessingPipeline> pipeline_;
 };
 
+// Preprocessing that writes straight into the input tensor instead of transforming the image, see fused_preprocessor.h
+class TensorPreprocessor
+{
+    public:
+    // Returns false if the image cannot be handled (e.g. enlarging only one dimension),
+    // in which case the transformation chain has to be used instead
+    virtual bool apply(const Image& image, float* tensor) = 0;
+    virtual ~TensorPreprocessor() = default;
+};
+
 #endif // #ifndef IMAGE_PREPROCESSOR_H_
\ No newline at end of file
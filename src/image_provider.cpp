@@ -1,14 +1,29 @@
 #include "image_provider.h"
-#include <opencv2/dnn/dnn.hpp>
-#include <cmath>
-#include <algorithm>
+#include "still_image_source.h"
+#include "video_file_source.h"
 
-Image ImageProvider::GetImage()
+ImageProvider::ImageProvider(const ImageProviderOptions& options)
 {
-    const std::string& absImagePath = (*imageIt_).string();
+    if (!options.videoPath.empty())
+    {
+        source_ = std::make_unique<VideoFileSource>(options);
+    }
+    else
+    {
+        source_ = std::make_unique<StillImageSource>(options);
+    }
+}
 
-    cv::Mat imageBGR = cv::imread(absImagePath, cv::ImreadModes::IMREAD_COLOR);
-    imageIt_++;
+std::optional<Image> ImageProvider::GetImage()
+{
+    Image img = source_->NextFrame();
+
+    if (img.matrix.empty())
+    {
+        return std::nullopt;
+    }
+
+    img.sequenceNr = sequenceNr_++;
 
-    return Image{imageBGR, imageBGR.rows, imageBGR.cols, ColorFormat::BGR, MemoryLayout::HWC, absImagePath};
-}
\ No newline at end of file
+    return img;
+}
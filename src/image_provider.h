@@ -1,93 +1,53 @@
 #ifndef IMAGE_PROVIDER_H_
 #define IMAGE_PROVIDER_H_
 
-#include <opencv2/opencv.hpp>
+#include "image.h"
+#include "frame_source.h"
+#include "packed_dataset.h"
+#include "frame_pool.h"
+#include <chrono>
 #include <cstdint>
-#include <array>
+#include <memory>
+#include <optional>
 #include <string>
-#include <vector>
-#include <filesystem>
 
-enum class ColorFormat : uint8_t
+struct ImageProviderOptions
 {
-    RGB = 0,
-    BGR = 1
-};
-
-enum class MemoryLayout : uint8_t
-{
-    HWC = 0,
-    CHW = 1
-};
-
-struct Image
-{
-    cv::Mat matrix;
-    int height;
-    int  width;
-    ColorFormat fmt;
-    MemoryLayout layout;
-    std::string path;
-};
-
-class ImageIterator
-{
-    public:
-    using iterator_category = std::forward_iterator_tag;
-    using value_type = std::filesystem::path;
-    using reference = const value_type&;
-    using pointer = const value_type*;
-    using difference_type = std::ptrdiff_t;
-
-    ImageIterator(std::vector<value_type>::const_iterator imageEntryIt
-    , std::vector<value_type>::const_iterator imageEntryItBegin
-    , std::vector<value_type>::const_iterator imageEntryItEnd) : 
-    imageEntryIt_{imageEntryIt},  imageEntryItBegin_{imageEntryItBegin}, imageEntryItEnd_{imageEntryItEnd}{}
-    reference operator*() const { return *imageEntryIt_; }
-    pointer operator->() const { return &(*imageEntryIt_); }
-    ImageIterator& operator++()
-    {
-        ++imageEntryIt_;
-        if (imageEntryIt_ == imageEntryItEnd_)
-        {
-            imageEntryIt_ = imageEntryItBegin_;
-        }
-
-        return *this;
-    }
-    ImageIterator operator++(int) { ImageIterator tempIt{*this}; operator++(); return tempIt; }
-
-    friend bool operator==(const ImageIterator& it1, const ImageIterator& it2) { return (it1.imageEntryIt_ == it2.imageEntryIt_); }
-    friend bool operator!=(const ImageIterator& it1, const ImageIterator& it2) { return !(it1.imageEntryIt_ == it2.imageEntryIt_); }
-
-    private:
-    std::vector<value_type>::const_iterator imageEntryIt_;
-    std::vector<value_type>::const_iterator imageEntryItBegin_;
-    std::vector<value_type>::const_iterator imageEntryItEnd_;
+    // Directory the still images are read from, if neither a packed dataset nor a video is set
+    std::string imagesPath{"assets/images/"};
+    // Threads decoding images ahead of GetImage() calls, 0 decodes synchronously on the calling thread
+    size_t decodeThreads{0};
+    // Number of images decoded ahead of GetImage() calls
+    size_t readAheadDepth{0};
+    // Size the images are preprocessed to later on. If set, JPEGs are decoded at the smallest
+    // power of two reduced resolution (DCT domain downscaling) that still covers it.
+    int targetHeight{0};
+    int targetWidth{0};
+    // Packed dataset streamed instead of the images directory. Raw frames reference the mapping
+    // without copying, hence it has to outlive all images handed out.
+    std::shared_ptr<const PackedDataset> packedDataset;
+    // Pool the decoded pixels are stored in. Frames are allocated by the decoder if not set, if the pool is
+    // exhausted or if the decoded size is not known before decoding (only JPEG headers are parsed).
+    std::shared_ptr<FramePool> framePool;
+    // Video file streamed instead of still images, decoded on a thread of its own at the frame rate of the stream
+    std::string videoPath;
+    // Video frames older than this when they are requested are dropped in favor of fresher ones, 0 never drops
+    std::chrono::milliseconds maxFrameAge{0};
 };
 
+// Hands out the frames of the configured source in capture order
 class ImageProvider
 {
     public:
-    ImageProvider() : imageEntries_{populateImageEntries()}, imageIt_{imageEntries_.cbegin(), imageEntries_.cbegin(), imageEntries_.cend()} {}
-    Image GetImage();
+    explicit ImageProvider(const ImageProviderOptions& options = ImageProviderOptions{});
+    // Empty once the source failed, see getSourceError()
+    std::optional<Image> GetImage();
+    FrameSourceStats getSourceStats() const { return source_->getStats(); }
+    std::string getSourceError() const { return source_->getError(); }
 
     private:
-    static std::vector<std::filesystem::path> populateImageEntries()
-    {
-        std::vector<std::filesystem::path> imageEntries;
-
-        for (const auto& imageEntry : std::filesystem::directory_iterator{imagesPath_})
-        {
-            imageEntries.push_back(imageEntry.path());
-        }
-
-        return imageEntries;
-    }
-
-    static constexpr const char* const imagesPath_ = "assets/images/";
-    std::vector<std::filesystem::path> imageEntries_;
-    ImageIterator imageIt_;
+    std::unique_ptr<FrameSource> source_;
+    uint64_t sequenceNr_{0};
 };
 
-#endif // #ifndef IMAGE_PROVIDER_H_
\ No newline at end of file
+#endif // #ifndef IMAGE_PROVIDER_H_
@@ -0,0 +1,130 @@
+#include "ipc_protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+bool SendMessage(int socketFd, const void* message, size_t size, int flags)
+{
+    const char* data = static_cast<const char*>(message);
+
+    while (size > 0)
+    {
+        // MSG_NOSIGNAL turns a disconnected peer into an error instead of SIGPIPE
+        const ssize_t sent = ::send(socketFd, data, size, MSG_NOSIGNAL | flags);
+
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (sent <= 0)
+        {
+            return false;
+        }
+
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+
+    return true;
+}
+
+bool ReceiveMessage(int socketFd, void* message, size_t size)
+{
+    char* data = static_cast<char*>(message);
+
+    while (size > 0)
+    {
+        const ssize_t received = ::recv(socketFd, data, size, 0);
+
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (received <= 0)
+        {
+            return false;
+        }
+
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+
+    return true;
+}
+
+bool SendMessageWithFd(int socketFd, const void* message, size_t size, int fd)
+{
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+
+    iovec iov{const_cast<void*>(message), size};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t sent;
+
+    do
+    {
+        sent = ::sendmsg(socketFd, &msg, MSG_NOSIGNAL);
+    }
+    while (sent < 0 && errno == EINTR);
+
+    if (sent <= 0)
+    {
+        return false;
+    }
+
+    // The descriptor went out with the first byte, the rest of the message follows as usual
+    return SendMessage(socketFd, static_cast<const char*>(message) + sent, size - static_cast<size_t>(sent));
+}
+
+bool ReceiveMessageWithFd(int socketFd, void* message, size_t size, int& receivedFd)
+{
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+
+    iovec iov{message, size};
+
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    receivedFd = -1;
+
+    ssize_t received;
+
+    do
+    {
+        received = ::recvmsg(socketFd, &msg, MSG_CMSG_CLOEXEC);
+    }
+    while (received < 0 && errno == EINTR);
+
+    if (received <= 0)
+    {
+        return false;
+    }
+
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            std::memcpy(&receivedFd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    return ReceiveMessage(socketFd, static_cast<char*>(message) + received, size - static_cast<size_t>(received));
+}
@@ -0,0 +1,79 @@
+#ifndef IPC_PROTOCOL_H_
+#define IPC_PROTOCOL_H_
+
+#include "postprocessor.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Messages exchanged with Icarus_server over its Unix domain socket. Clients run on the same host,
+// hence messages are plain fixed size structs in host byte order. Frame pixels never travel over the
+// socket, requests refer to a slot of the client's SharedFrameRing instead.
+constexpr const char* const kDefaultSocketPath{"/tmp/icarus.sock"};
+constexpr uint32_t kProtocolMagic{0x49435253};
+constexpr uint32_t kProtocolVersion{1};
+constexpr size_t kMaxModelNameLength{32};
+// Largest frame height and width accepted, which keeps the frame size far from overflowing
+constexpr uint32_t kMaxFrameDimension{16384};
+// Largest frame ring a client may map into the server, in slots and in bytes. The responses to a full ring of
+// requests, including the per message overhead of the socket, fit into the default socket send buffer.
+constexpr uint32_t kMaxRingSlots{128};
+constexpr uint64_t kMaxRingSize{1ULL << 30};
+
+enum class ResponseStatus : uint32_t
+{
+    Ok = 0,
+    // Malformed hello, ring that could not be mapped, slot index out of range or frame exceeding its slot
+    InvalidRequest = 1,
+    UnknownModel = 2,
+    // The client already has as many requests in flight as its ring has slots
+    TooManyRequests = 3
+};
+
+// First message of a connection, sent together with the file descriptor of the frame ring
+struct HelloRequest
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nrOfSlots;
+    uint32_t slotSize;
+    // Registered name of the model classifying the frames of this connection, zero terminated
+    std::array<char, kMaxModelNameLength> modelName;
+};
+
+struct HelloResponse
+{
+    ResponseStatus status;
+    // Classes reported per frame
+    uint32_t topK;
+};
+
+// Classifies the 8 bit BGR HWC frame in the given slot. Requests may be pipelined up to the number of slots,
+// responses can arrive out of order. A client that does not read its responses in time is disconnected.
+struct ClassifyRequest
+{
+    uint64_t requestId;
+    uint32_t slotIdx;
+    uint32_t height;
+    uint32_t width;
+};
+
+struct ClassifyResponse
+{
+    uint64_t requestId;
+    uint32_t slotIdx;
+    ResponseStatus status;
+    uint32_t nrOfScores;
+    std::array<uint32_t, Prediction::kMaxTopK> classIdxs;
+    std::array<float, Prediction::kMaxTopK> probabilities;
+};
+
+// Blocking transfer of a whole message, false if the peer disconnected or an error occurred.
+// With MSG_DONTWAIT in flags, a send buffer too full for the message fails instead of blocking.
+bool SendMessage(int socketFd, const void* message, size_t size, int flags = 0);
+bool ReceiveMessage(int socketFd, void* message, size_t size);
+// Same for a message carrying a file descriptor (SCM_RIGHTS), receivedFd is -1 if none was attached
+bool SendMessageWithFd(int socketFd, const void* message, size_t size, int fd);
+bool ReceiveMessageWithFd(int socketFd, void* message, size_t size, int& receivedFd);
+
+#endif // #ifndef IPC_PROTOCOL_H_
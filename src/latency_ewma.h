@@ -0,0 +1,37 @@
+#ifndef LATENCY_EWMA_H_
+#define LATENCY_EWMA_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Exponentially weighted moving average of a latency, recorded and read by several threads without locking
+class LatencyEwma
+{
+    public:
+    // Weight of a new sample, higher values follow load changes faster but smooth out less jitter
+    explicit LatencyEwma(double smoothing = 0.2) : smoothing_{smoothing} {}
+
+    void Record(std::chrono::nanoseconds sample)
+    {
+        int64_t average = average_.load(std::memory_order_relaxed);
+        int64_t updated;
+
+        do
+        {
+            // The first sample initializes the average
+            updated = (average < 0) ? sample.count() : average + static_cast<int64_t>(smoothing_ * static_cast<double>(sample.count() - average));
+        }
+        while (!average_.compare_exchange_weak(average, updated, std::memory_order_relaxed));
+    }
+
+    // Zero until the first sample was recorded
+    std::chrono::nanoseconds get() const noexcept { return std::chrono::nanoseconds{std::max<int64_t>(average_.load(std::memory_order_relaxed), 0)}; }
+
+    private:
+    double smoothing_;
+    std::atomic<int64_t> average_{-1};
+};
+
+#endif // #ifndef LATENCY_EWMA_H_
@@ -0,0 +1,131 @@
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct LatencyHistogramSnapshot;
+
+// Lock-free histogram of latencies in microseconds with log-linear buckets (HDR style): values below
+// 2^kSubBucketBits are counted exactly, every further power of two range is split into 2^kSubBucketBits
+// equally wide buckets, bounding the relative error to 1/2^kSubBucketBits. Recording is a few relaxed atomic adds.
+class LatencyHistogram
+{
+    public:
+    static constexpr unsigned kSubBucketBits{4};
+    static constexpr uint64_t kSubBuckets{uint64_t{1} << kSubBucketBits};
+    // Values of 2^kMaxMagnitude microseconds (~19h) and above go to the last bucket
+    static constexpr unsigned kMaxMagnitude{36};
+    static constexpr size_t kNrOfBuckets{kSubBuckets + (kMaxMagnitude - kSubBucketBits) * kSubBuckets};
+
+    LatencyHistogram() = default;
+    LatencyHistogram(const LatencyHistogram& other) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram& other) = delete;
+
+    void Record(uint64_t valueUs) noexcept
+    {
+        counts_[BucketIndex(valueUs)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sumUs_.fetch_add(valueUs, std::memory_order_relaxed);
+    }
+
+    static size_t BucketIndex(uint64_t valueUs) noexcept
+    {
+        if (valueUs < kSubBuckets)
+        {
+            return static_cast<size_t>(valueUs);
+        }
+
+        const unsigned magnitude = 63 - static_cast<unsigned>(__builtin_clzll(valueUs));
+
+        if (magnitude >= kMaxMagnitude)
+        {
+            return kNrOfBuckets - 1;
+        }
+
+        const unsigned shift = magnitude - kSubBucketBits;
+
+        return static_cast<size_t>(kSubBuckets + shift * kSubBuckets + ((valueUs >> shift) - kSubBuckets));
+    }
+
+    // Largest value counted in the bucket
+    static uint64_t BucketUpperBound(size_t bucketIdx) noexcept
+    {
+        if (bucketIdx < kSubBuckets)
+        {
+            return bucketIdx;
+        }
+
+        const uint64_t shift = (bucketIdx - kSubBuckets) / kSubBuckets;
+        const uint64_t subBucket = (bucketIdx - kSubBuckets) % kSubBuckets;
+
+        return ((kSubBuckets + subBucket + 1) << shift) - 1;
+    }
+
+    // Not atomic as a whole, concurrent recordings may be partially included
+    LatencyHistogramSnapshot getSnapshot() const noexcept;
+
+    private:
+    std::array<std::atomic<uint64_t>, kNrOfBuckets> counts_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sumUs_{0};
+};
+
+struct LatencyHistogramSnapshot
+{
+    std::array<uint64_t, LatencyHistogram::kNrOfBuckets> counts;
+    uint64_t count;
+    uint64_t sumUs;
+
+    // Upper bound of the bucket holding the value at the given quantile (0..1)
+    uint64_t ValueAtQuantile(double quantile) const noexcept
+    {
+        uint64_t totalCount = 0;
+
+        for (uint64_t bucketCount : counts)
+        {
+            totalCount += bucketCount;
+        }
+
+        if (totalCount == 0)
+        {
+            return 0;
+        }
+
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * totalCount + 0.5));
+
+        uint64_t cumulativeCount = 0;
+
+        for (size_t bucketIdx = 0; bucketIdx < counts.size(); bucketIdx++)
+        {
+            cumulativeCount += counts[bucketIdx];
+
+            if (cumulativeCount >= rank)
+            {
+                return LatencyHistogram::BucketUpperBound(bucketIdx);
+            }
+        }
+
+        return LatencyHistogram::BucketUpperBound(counts.size() - 1);
+    }
+};
+
+inline LatencyHistogramSnapshot LatencyHistogram::getSnapshot() const noexcept
+{
+    LatencyHistogramSnapshot snapshot;
+
+    for (size_t bucketIdx = 0; bucketIdx < kNrOfBuckets; bucketIdx++)
+    {
+        snapshot.counts[bucketIdx] = counts_[bucketIdx].load(std::memory_order_relaxed);
+    }
+
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sumUs = sumUs_.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+#endif // #ifndef LATENCY_HISTOGRAM_H_
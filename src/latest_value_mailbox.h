@@ -0,0 +1,81 @@
+#ifndef LATEST_VALUE_MAILBOX_H_
+#define LATEST_VALUE_MAILBOX_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+struct MailboxStats
+{
+    uint64_t published;
+    uint64_t taken;
+    // Values overwritten by a newer one before they were taken
+    uint64_t superseded;
+};
+
+// Single-slot mailbox holding only the most recent value. Publishing never waits for the consumer,
+// a value that was not taken yet is simply replaced, so a slow consumer cannot apply backpressure.
+template <typename T>
+class LatestValueMailbox
+{
+    public:
+    LatestValueMailbox() = default;
+    LatestValueMailbox(const LatestValueMailbox& other) = delete;
+    LatestValueMailbox& operator=(const LatestValueMailbox& other) = delete;
+
+    void publish(T value)
+    {
+        {
+            std::lock_guard<std::mutex> lgValue{mtxValue_};
+
+            if (value_.has_value())
+            {
+                superseded_++;
+            }
+
+            value_ = std::move(value);
+            published_++;
+        }
+
+        cvValueAvailable_.notify_one();
+    }
+
+    // Takes the latest value, waiting for one until the deadline at most
+    template <typename Clock, typename Duration>
+    std::optional<T> takeUntil(const std::chrono::time_point<Clock, Duration>& deadline)
+    {
+        std::unique_lock<std::mutex> ulValue{mtxValue_};
+
+        cvValueAvailable_.wait_until(ulValue, deadline, [this]() { return value_.has_value(); });
+
+        std::optional<T> value{std::move(value_)};
+        value_.reset();
+
+        if (value.has_value())
+        {
+            taken_++;
+        }
+
+        return value;
+    }
+
+    MailboxStats getStats() const
+    {
+        std::lock_guard<std::mutex> lgValue{mtxValue_};
+
+        return MailboxStats{published_, taken_, superseded_};
+    }
+
+    private:
+    mutable std::mutex mtxValue_;
+    std::condition_variable cvValueAvailable_;
+    std::optional<T> value_;
+    uint64_t published_{0};
+    uint64_t taken_{0};
+    uint64_t superseded_{0};
+};
+
+#endif // #ifndef LATEST_VALUE_MAILBOX_H_
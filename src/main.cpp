@@ -1,7 +1,20 @@
+#include "config.h"
+#include "bounded_queue.h"
+#include "fair_scheduler.h"
+#include "latest_value_mailbox.h"
+#include "reorder_buffer.h"
+#include "latency_ewma.h"
+#include "tensor_cache.h"
+#include "result_cache.h"
+#include "hash.h"
 #include "runtime.h"
 #include "model_handler.h"
+#include "model_registry.h"
+#include "postprocessor.h"
 #include "image_provider.h"
 #include "image_preprocessor.h"
+#include "stage_metrics.h"
+#include "thread_placement.h"
 #include <iostream>
 #include <array>
 #include <vector>
@@ -11,151 +24,583 @@
 #include <chrono>
 #include <thread>
 #include <mutex>
-#include <condition_variable>
-#include <queue>
+#include <optional>
+#include <memory>
 #include <iterator>
 #include <utility>
 #include <future>
+#include <functional>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <string_view>
+#include <limits>
+#include <atomic>
+
+// Captured images waiting per model, workers take batches from the models in turn. Closed once capturing stopped,
+// which wakes up all workers waiting for input so they can terminate.
+std::unique_ptr<FairScheduler<Image>> inputImageScheduler;
 
-std::condition_variable cvInputAvailable;
-std::mutex mtxInput;
-std::queue<Image> inputImageQueue;
-
-std::condition_variable cvClassifierResultReady;
 std::mutex mtxClassifierResult;
-using LabelledImage = std::pair<Image, std::string>;
+using LabelledImage = std::pair<Image, Prediction>;
 
 struct ClassifierResult
 {
     LabelledImage labelledImage_;
     std::chrono::milliseconds inferenceTime_;
+    // Name held by the model registry, which outlives all results
+    std::string_view modelName_;
 
     ClassifierResult() = default;
-    ClassifierResult(LabelledImage labelledImage, std::chrono::milliseconds inferenceTime) : labelledImage_{labelledImage}, inferenceTime_{inferenceTime} {}
+    ClassifierResult(LabelledImage&& labelledImage, std::chrono::milliseconds inferenceTime, std::string_view modelName)
+        : labelledImage_{std::move(labelledImage)}, inferenceTime_{inferenceTime}, modelName_{modelName} {}
 };
 
-std::queue<ClassifierResult> classifierResultQueue;
+// Only the latest classified image is displayed, the display stage never applies backpressure to inference
+LatestValueMailbox<ClassifierResult> classifierResultMailbox;
+
+// Results of frames classified out of capture order by concurrent workers wait here until all of their predecessors arrived.
+// Frames dropped before inference leave an empty entry behind, so that their successors are not held back.
+std::unique_ptr<ReorderBuffer<ClassifierResult>> pendingClassifierResults;
+
+// Preprocessed tensors of recurring images, only created if a memory budget is configured
+std::unique_ptr<TensorCache> tensorCache;
+
+// Predictions of frames seen before, only created if a result cache mode is configured
+std::unique_ptr<ResultCache> resultCache;
+
+StageMetrics stageMetrics;
+
+// Session time per frame across all workers and models, paces the capture stage
+LatencyEwma inferenceTimePerFrame;
 
-void ImageCaptureThread(std::shared_future<void> futTerminate)
+// Frames dropped before preprocessing because they could not have met their deadline anymore
+std::atomic<uint64_t> expiredFrames{0};
+
+// Set by the capture thread when the image provider cannot deliver frames anymore, the display thread then initiates the shutdown
+std::atomic<bool> sourceFailed{false};
+
+// Handler and runtime of one model within a worker, the runtime slots are released into its own free slot queue
+struct WorkerModel
 {
-    using namespace std::chrono_literals;
+    std::string_view name_;
+    std::unique_ptr<ModelHandler> modelHandler_;
+    std::unique_ptr<Runtime> runtime_;
+    // Tells the predictions of this model apart from those of other models and preprocessing configurations in the result cache
+    uint64_t resultCacheKey_;
+    BoundedQueue<size_t> freeSlotQueue_;
+    std::vector<std::vector<LabelledImage>> slotImages_;
+    // Result cache key per image of a slot, nothing for images not cached
+    std::vector<std::vector<std::optional<uint64_t>>> slotContentKeys_;
+    // Session time per batch, written by the inference thread and read by the preprocessing thread for admission control
+    LatencyEwma executeLatency_;
+
+    WorkerModel(std::string_view name, std::unique_ptr<ModelHandler> modelHandler, std::unique_ptr<Runtime> runtime, size_t nrOfSlots)
+        : name_{name}, modelHandler_{std::move(modelHandler)}, runtime_{std::move(runtime)},
+          resultCacheKey_{Fnv1aHashValue(modelHandler_->getPreprocessSignature(), Fnv1aHash(name))}, freeSlotQueue_{nrOfSlots, OverflowPolicy::Block} {}
+};
 
-    ImageProvider imgProvider;
+struct SlotRef
+{
+    // Index into the models of the worker, kEndOfInput tells the following stages that there is no more input
+    size_t modelIdx;
+    size_t slotIdx;
+};
+
+constexpr size_t kEndOfInput{std::numeric_limits<size_t>::max()};
+
+// Runtime slots cycle through the stages of a worker: the preprocessing thread fills the input of a free slot of the model
+// it took a batch for, the inference thread runs the session on it and the postprocessing thread evaluates its output and
+// releases it. Slots pass every stage in FIFO order, so the batches of a worker leave it in the order they were collected.
+struct InferenceWorker
+{
+    std::vector<std::unique_ptr<WorkerModel>> models_;
+    BoundedQueue<SlotRef> preparedSlotQueue_;
+    BoundedQueue<SlotRef> inferredSlotQueue_;
+
+    explicit InferenceWorker(size_t nrOfSlots) : preparedSlotQueue_{nrOfSlots, OverflowPolicy::Block}, inferredSlotQueue_{nrOfSlots, OverflowPolicy::Block} {}
+};
+
+// Releases results in capture order, expects mtxClassifierResult to be held
+void ReleaseClassifierResults()
+{
+    pendingClassifierResults->release([](ClassifierResult&& result) { classifierResultMailbox.publish(std::move(result)); });
+}
+
+// Marks a frame that will never be classified
+void SkipClassifierResult(uint64_t sequenceNr)
+{
+    std::lock_guard<std::mutex> lgClassifierResult{mtxClassifierResult};
+
+    pendingClassifierResults->insert(sequenceNr, std::nullopt);
+
+    ReleaseClassifierResults();
+}
+
+void PrintQueueStats(const std::string& queueName, const QueueStats& stats)
+{
+    std::cout << queueName << ": pushed " << stats.pushed << ", popped " << stats.popped << ", dropped " << stats.dropped
+              << ", occupancy " << stats.occupancy << "/" << stats.capacity << ", peak occupancy " << stats.peakOccupancy << "\n";
+}
+
+// Capturing never outpaces the rate the workers can sustain, as measured by the session time per frame
+std::chrono::steady_clock::duration CaptureInterval(const Config& config)
+{
+    return std::max<std::chrono::steady_clock::duration>(config.minCaptureInterval, inferenceTimePerFrame.get() / config.nrOfWorkers);
+}
+
+// Routes the captured images to the models in turn
+void ImageCaptureThread(std::shared_future<void> futTerminate, Config config, ImageProvider& imgProvider, const ModelRegistry& registry, std::vector<size_t> modelIdxs)
+{
+    size_t nextModel = 0;
 
     while (futTerminate.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready)
     {
-        std::this_thread::sleep_for(500ms);
+        std::this_thread::sleep_for(CaptureInterval(config));
+
+        const auto captureStartTime = std::chrono::steady_clock::now();
+
+        std::optional<Image> capturedImg = imgProvider.GetImage();
+
+        if (!capturedImg.has_value())
+        {
+            std::cerr << imgProvider.getSourceError() << std::endl;
+
+            sourceFailed.store(true, std::memory_order_release);
+
+            break;
+        }
+
+        Image& img = *capturedImg;
 
-        auto img = imgProvider.GetImage();
+        img.trace.captureStart = captureStartTime;
+        img.trace.captureEnd = std::chrono::steady_clock::now();
 
+        if (config.latencySlo.count() > 0)
         {
-            std::lock_guard<std::mutex> lgInput{mtxInput};
-            inputImageQueue.push(img);
-            std::cout << "Captured image: " << img.path << std::endl;
+            img.deadline = captureStartTime + config.latencySlo;
         }
 
-        cvInputAvailable.notify_one();
+        const size_t queueIdx = nextModel;
+
+        nextModel = (nextModel + 1) % modelIdxs.size();
+
+        std::cout << "Captured image: " << img.path << " -> " << registry.getName(modelIdxs[queueIdx]) << std::endl;
+
+        // Making room for the image may evict several queued ones, the display must not wait for any of them
+        (void)inputImageScheduler->push(queueIdx, std::move(img), [](Image&& droppedImg)
+        {
+            std::cout << "Dropped image: " << droppedImg.path << std::endl;
+
+            SkipClassifierResult(droppedImg.sequenceNr);
+        });
     }
 }
 
-void InferenceThread(std::shared_future<void> futTerminate)
+void ReportPreprocessDeviation(ModelHandler& modelHandler, const Image& img)
 {
-    MobileNetV2ModelHandler modelHandler;
+    // The fused kernel rounds resampled pixels like the reference resize, so outputs may differ by one 8 bit level at most
+    constexpr float kMaxPreprocessDeviation{0.02f};
 
-    std::vector<float>& inputValues = modelHandler.getInputBuffer();
-    std::vector<float>& outputValues = modelHandler.getOutputBuffer();
+    auto deviation = modelHandler.VerifyFusedPreprocess(img);
 
-    modelHandler.BuildPreprocessPipeline();
+    if (!deviation.has_value())
+    {
+        std::cout << "Fused preprocessing not applicable to image: " << img.path << "\n";
+    }
+    else if (*deviation > kMaxPreprocessDeviation)
+    {
+        std::cerr << "Fused preprocessing deviates by " << *deviation << " from the reference for image: " << img.path << std::endl;
+    }
+    else
+    {
+        std::cout << "Fused preprocessing max deviation: " << *deviation << "\n";
+    }
+}
 
-    auto& runtime = Runtime::Instance();
+// Preprocesses the image into the tensor, or copies its cached preprocessed tensor if the same file version was preprocessed before
+void PreprocessImage(ModelHandler& modelHandler, Image& img, float* tensor)
+{
+    if (tensorCache == nullptr || img.fileSize == 0)
+    {
+        modelHandler.Preprocess(img, tensor);
 
-    runtime.Prepare(modelHandler.getModelPath(), inputValues, outputValues, modelHandler.getInputBatches());
-    runtime.PrintModelInfo();
+        return;
+    }
 
-    while (futTerminate.wait_for(std::chrono::milliseconds(0)) != std::future_status::ready)
+    const size_t tensorSize = modelHandler.getInputSize();
+    const TensorCacheKey cacheKey{img.path, img.modificationTime, img.fileSize, img.height, img.width, modelHandler.getPreprocessSignature()};
+
+    if (!tensorCache->Lookup(cacheKey, tensor, tensorSize))
     {
-        Image img;
+        modelHandler.Preprocess(img, tensor);
+        tensorCache->Insert(cacheKey, tensor, tensorSize);
+    }
+}
+
+void PublishClassifierResults(std::vector<LabelledImage>& labelledImages, std::chrono::milliseconds inferenceTime, std::string_view modelName)
+{
+    std::lock_guard<std::mutex> lgClassifierResult{mtxClassifierResult};
 
+    for (auto& labelledImg : labelledImages)
+    {
+        const uint64_t sequenceNr = std::get<Image>(labelledImg).sequenceNr;
+
+        pendingClassifierResults->insert(sequenceNr, ClassifierResult{std::move(labelledImg), inferenceTime, modelName});
+    }
+
+    ReleaseClassifierResults();
+}
+
+// Publishes the images of the batch whose predictions are cached and removes them from the batch. The cache keys of the
+// remaining images are returned in contentKeys, in batch order.
+void ServeCachedResults(WorkerModel& model, std::vector<Image>& batch, std::vector<std::optional<uint64_t>>& contentKeys, std::vector<LabelledImage>& cachedImages)
+{
+    contentKeys.clear();
+    cachedImages.clear();
+
+    const LabelTable& labels = model.modelHandler_->getLabelTable();
+
+    size_t keptIdx = 0;
+
+    for (size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++)
+    {
+        Image& img = batch[batchIdx];
+
+        const auto lookupTime = std::chrono::steady_clock::now();
+        const std::optional<uint64_t> contentKey = resultCache->ComputeKey(img);
+
+        Prediction prediction;
+
+        if (!contentKey.has_value() || !resultCache->Lookup(*contentKey, model.resultCacheKey_, prediction))
         {
-            std::unique_lock<std::mutex> ulInput{mtxInput};
-            cvInputAvailable.wait(ulInput, [&]()
+            contentKeys.push_back(contentKey);
+
+            if (keptIdx != batchIdx)
             {
-                return !inputImageQueue.empty();
-            });
+                batch[keptIdx] = std::move(img);
+            }
 
-            img = std::move(inputImageQueue.front());
-            inputImageQueue.pop();
+            keptIdx++;
+            continue;
         }
 
-        LabelledImage labelledImg{img, "Unknown"};
+        // The cached labels may refer to the label table of another worker's handler
+        for (ClassScore& classScore : prediction)
+        {
+            classScore.label = labels[classScore.classIdx];
+        }
 
-        modelHandler.Preprocess(img);
+        std::cout << "Predicted image [" << model.name_ << "] (cached):";
 
-        inputValues.assign(std::make_move_iterator(img.matrix.begin<float>()), std::make_move_iterator(img.matrix.end<float>()));
+        for (const ClassScore& classScore : prediction)
+        {
+            std::cout << " " << classScore.label << " (" << std::fixed << std::setprecision(1) << classScore.probability * 100.0f << "%)";
+        }
 
-        std::chrono::steady_clock::time_point inferenceStartTime = std::chrono::steady_clock::now();
-        runtime.Execute();
-        std::chrono::steady_clock::time_point inferenceEndTime = std::chrono::steady_clock::now();
+        std::cout << "\n";
+
+        // Only the waiting time is recorded, the frame skips the preprocessing, inference and postprocessing stages
+        img.trace.preprocessStart = lookupTime;
+        img.trace.postprocessEnd = std::chrono::steady_clock::now();
+
+        stageMetrics.RecordProcessed(img.trace);
+
+        cachedImages.emplace_back(std::move(img), prediction);
+    }
+
+    batch.resize(keptIdx);
+
+    if (!cachedImages.empty())
+    {
+        PublishClassifierResults(cachedImages, std::chrono::milliseconds{0}, model.name_);
+    }
+}
+
+void PreprocessThread(Config config, InferenceWorker& worker)
+{
+    std::vector<size_t> maxBatchSizes;
+
+    for (const auto& model : worker.models_)
+    {
+        maxBatchSizes.push_back(static_cast<size_t>(model->runtime_->getMaxBatchSize()));
+    }
+
+    std::vector<Image> batch;
+    batch.reserve(*std::max_element(maxBatchSizes.cbegin(), maxBatchSizes.cend()));
+
+    std::vector<std::optional<uint64_t>> contentKeys;
+    std::vector<LabelledImage> cachedImages;
+
+    // A frame is dropped if its deadline would pass even if the session ran on it right away
+    auto admitFrame = [&worker](size_t modelIdx, Image& img)
+    {
+        if (img.deadline == std::chrono::steady_clock::time_point{} ||
+            std::chrono::steady_clock::now() + worker.models_[modelIdx]->executeLatency_.get() <= img.deadline)
+        {
+            return true;
+        }
 
-        auto inferenceTime = std::chrono::duration_cast<std::chrono::milliseconds>(inferenceEndTime - inferenceStartTime);
+        const Image expiredImg = std::move(img);
 
-        auto predictedClass = modelHandler.Postprocess();
+        std::cout << "Expired image: " << expiredImg.path << std::endl;
 
-        std::cout << "Predicted image: " << predictedClass << " Inference Time: " << inferenceTime.count() << "ms\n";
+        expiredFrames.fetch_add(1, std::memory_order_relaxed);
+        SkipClassifierResult(expiredImg.sequenceNr);
 
-        std::get<std::string>(labelledImg) = predictedClass;
+        return false;
+    };
+
+    while (true)
+    {
+        // Queue indices of the scheduler match the model indices of the worker
+        std::optional<size_t> modelIdx = inputImageScheduler->popBatch(batch, maxBatchSizes, config.maxBatchDelay, admitFrame);
+
+        // Once the closed input is drained, the following stages are told that there is no more input
+        if (!modelIdx.has_value())
+        {
+            (void)worker.preparedSlotQueue_.push(SlotRef{kEndOfInput, 0});
+            break;
+        }
+
+        WorkerModel& model = *worker.models_[*modelIdx];
+        ModelHandler& modelHandler = *model.modelHandler_;
+        Runtime& runtime = *model.runtime_;
+
+        if (resultCache != nullptr)
+        {
+            ServeCachedResults(model, batch, contentKeys, cachedImages);
+
+            // Batches served from the cache entirely do not take a slot
+            if (batch.empty())
+            {
+                continue;
+            }
+        }
+
+        const int64_t inputSize = modelHandler.getInputSize();
+        const int64_t frameSize = modelHandler.getInputHeight() * modelHandler.getInputWidth() * 3;
+
+        size_t slotIdx;
+
+        (void)model.freeSlotQueue_.pop(slotIdx);
+
+        // The slot is owned exclusively by this thread until it is handed over to the inference thread
+        float* inputValues = runtime.getSlot(slotIdx).getInputData();
+        std::vector<LabelledImage>& labelledImages = model.slotImages_[slotIdx];
+
+        labelledImages.clear();
+
+        if (resultCache != nullptr)
+        {
+            model.slotContentKeys_[slotIdx] = contentKeys;
+        }
 
+        for (size_t batchIdx = 0; batchIdx < batch.size(); batchIdx++)
         {
-            std::lock_guard<std::mutex> lgClassifierResult{mtxClassifierResult};
-            classifierResultQueue.emplace(labelledImg, inferenceTime);
+            // The labelled image keeps the captured pixels for the display, preprocessing works on a copy sharing them
+            Image img = batch[batchIdx].Borrow();
+
+            labelledImages.emplace_back(std::move(batch[batchIdx]), Prediction{});
+
+            FrameTrace& trace = std::get<Image>(labelledImages.back()).trace;
+
+            if (config.verifyPreprocess)
+            {
+                ReportPreprocessDeviation(modelHandler, img);
+            }
+
+            trace.preprocessStart = std::chrono::steady_clock::now();
+            if (config.preprocessMode == PreprocessMode::InGraph)
+            {
+                modelHandler.PreprocessFrame(img, runtime.getSlot(slotIdx).getFrameData() + batchIdx * frameSize);
+            }
+            else
+            {
+                PreprocessImage(modelHandler, img, inputValues + batchIdx * inputSize);
+            }
+            trace.preprocessEnd = std::chrono::steady_clock::now();
         }
 
-        cvClassifierResultReady.notify_one();
+        (void)worker.preparedSlotQueue_.push(SlotRef{*modelIdx, slotIdx});
     }
 }
 
-void ImageDisplayThread(std::promise<void>&& prmsTerminate)
+void InferenceThread(InferenceWorker& worker)
 {
-    const std::string& displayWindowName = "Classifier Result Window";
+    while (true)
+    {
+        SlotRef slotRef{};
 
-    cv::namedWindow(displayWindowName, cv::WINDOW_NORMAL);
+        (void)worker.preparedSlotQueue_.pop(slotRef);
+
+        // The end of input is passed on to terminate the postprocessing thread as well
+        if (slotRef.modelIdx == kEndOfInput)
+        {
+            (void)worker.inferredSlotQueue_.push(slotRef);
+            break;
+        }
+
+        WorkerModel& model = *worker.models_[slotRef.modelIdx];
+        std::vector<LabelledImage>& labelledImages = model.slotImages_[slotRef.slotIdx];
+
+        std::chrono::steady_clock::time_point inferenceStartTime = std::chrono::steady_clock::now();
+        model.runtime_->Execute(slotRef.slotIdx, labelledImages.size());
+        std::chrono::steady_clock::time_point inferenceEndTime = std::chrono::steady_clock::now();
+
+        model.executeLatency_.Record(inferenceEndTime - inferenceStartTime);
+        inferenceTimePerFrame.Record((inferenceEndTime - inferenceStartTime) / labelledImages.size());
+
+        for (auto& labelledImg : labelledImages)
+        {
+            FrameTrace& trace = std::get<Image>(labelledImg).trace;
+
+            trace.inferenceStart = inferenceStartTime;
+            trace.inferenceEnd = inferenceEndTime;
+        }
+
+        (void)worker.inferredSlotQueue_.push(slotRef);
+    }
+}
+
+void PostprocessThread(InferenceWorker& worker)
+{
+    std::vector<Prediction> predictions;
 
     while (true)
     {
-        ClassifierResult result;
+        SlotRef slotRef{};
+
+        (void)worker.inferredSlotQueue_.pop(slotRef);
 
+        if (slotRef.modelIdx == kEndOfInput)
         {
-            std::unique_lock<std::mutex> ulClassifierResult{mtxClassifierResult};
-            cvClassifierResultReady.wait(ulClassifierResult, [&]()
+            break;
+        }
+
+        WorkerModel& model = *worker.models_[slotRef.modelIdx];
+        std::vector<LabelledImage>& labelledImages = model.slotImages_[slotRef.slotIdx];
+
+        const FrameTrace& batchTrace = std::get<Image>(labelledImages.front()).trace;
+        auto inferenceTime = std::chrono::duration_cast<std::chrono::milliseconds>(batchTrace.inferenceEnd - batchTrace.inferenceStart);
+
+        const float* outputValues = model.runtime_->getSlot(slotRef.slotIdx).getOutputData();
+
+        model.modelHandler_->Postprocess(outputValues, labelledImages.size(), predictions);
+
+        const std::chrono::steady_clock::time_point postprocessEndTime = std::chrono::steady_clock::now();
+
+        for (size_t batchIdx = 0; batchIdx < labelledImages.size(); batchIdx++)
+        {
+            std::cout << "Predicted image [" << model.name_ << "]:";
+
+            for (const ClassScore& classScore : predictions[batchIdx])
             {
-                return !classifierResultQueue.empty();
-            });
+                std::cout << " " << classScore.label << " (" << std::fixed << std::setprecision(1) << classScore.probability * 100.0f << "%)";
+            }
 
-            result = std::move(classifierResultQueue.front());
-            classifierResultQueue.pop();
+            std::cout << " Inference Time: " << inferenceTime.count() << "ms" << " Batch Size: " << labelledImages.size() << "\n";
+
+            std::get<Prediction>(labelledImages[batchIdx]) = predictions[batchIdx];
+
+            if (resultCache != nullptr && model.slotContentKeys_[slotRef.slotIdx][batchIdx].has_value())
+            {
+                resultCache->Insert(*model.slotContentKeys_[slotRef.slotIdx][batchIdx], model.resultCacheKey_, predictions[batchIdx]);
+            }
+
+            FrameTrace& trace = std::get<Image>(labelledImages[batchIdx]).trace;
+
+            trace.postprocessEnd = postprocessEndTime;
+
+            stageMetrics.RecordProcessed(trace);
         }
 
-        auto img = std::get<Image>(result.labelledImage_);
-        auto predictedClass = std::get<std::string>(result.labelledImage_);
-        auto time = result.inferenceTime_;
+        PublishClassifierResults(labelledImages, inferenceTime, model.name_);
 
-        std::ostringstream inferenceTimeOss;
+        (void)model.freeSlotQueue_.push(slotRef.slotIdx);
+    }
+}
 
-        inferenceTimeOss << "Inference Time: " << time.count() << "ms";
+// Draws the image below a title bar with the prediction into the canvas, which is only reallocated when the image size changes
+void ComposeResultCanvas(const ClassifierResult& result, cv::Mat& canvas)
+{
+    constexpr int kTitleBarHeight{40};
+    constexpr int kMinCanvasWidth{480};
 
-        cv::Size titleSize = cv::getTextSize(predictedClass, cv::FONT_HERSHEY_SIMPLEX, 1.0, 2, nullptr);
-        int displayWindowHeight = img.height + titleSize.height + 20;
-        int displayWindowWidth = std::max(img.width, titleSize.width + 20);
+    const Image& img = std::get<Image>(result.labelledImage_);
+    const Prediction& prediction = std::get<Prediction>(result.labelledImage_);
 
-        cv::resizeWindow(displayWindowName, displayWindowWidth, displayWindowHeight);
-        cv::imshow(displayWindowName, img.matrix);
+    const int canvasHeight = img.height + kTitleBarHeight;
+    const int canvasWidth = std::max(img.width, kMinCanvasWidth);
 
-        cv::setWindowTitle(displayWindowName, predictedClass + "----" + inferenceTimeOss.str());
+    if (canvas.rows != canvasHeight || canvas.cols != canvasWidth)
+    {
+        canvas.create(canvasHeight, canvasWidth, CV_8UC3);
+        canvas.setTo(cv::Scalar{0, 0, 0});
+    }
 
-        cv::waitKey(1500); 
+    cv::rectangle(canvas, cv::Rect{0, 0, canvasWidth, kTitleBarHeight}, cv::Scalar{0, 0, 0}, cv::FILLED);
+
+    cv::Mat imageRegion = canvas(cv::Rect{0, kTitleBarHeight, img.width, img.height});
+    img.matrix.copyTo(imageRegion);
+
+    std::array<char, 256> overlayText{};
+
+    if (!prediction.empty())
+    {
+        const ClassScore& top1 = prediction.front();
+
+        std::snprintf(overlayText.data(), overlayText.size(), "%.*s (%.1f%%) %lldms %.*s", static_cast<int>(top1.label.size()), top1.label.data(),
+                      top1.probability * 100.0f, static_cast<long long>(result.inferenceTime_.count()),
+                      static_cast<int>(result.modelName_.size()), result.modelName_.data());
+    }
+
+    cv::putText(canvas, overlayText.data(), cv::Point{10, 27}, cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar{255, 255, 255}, 2);
+}
+
+void ImageDisplayThread(std::promise<void>&& prmsTerminate, double maxDisplayFps)
+{
+    const std::string& displayWindowName = "Classifier Result Window";
+
+    cv::namedWindow(displayWindowName, cv::WINDOW_NORMAL);
+
+    const auto frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{1.0 / maxDisplayFps});
+
+    cv::Mat canvas;
+    cv::Size windowSize;
+
+    while (true)
+    {
+        const auto frameStartTime = std::chrono::steady_clock::now();
+
+        // Results published in the meantime replaced each other, only the latest one is shown
+        std::optional<ClassifierResult> result = classifierResultMailbox.takeUntil(frameStartTime + frameInterval);
+
+        if (result.has_value())
+        {
+            ComposeResultCanvas(*result, canvas);
+
+            if (windowSize.width != canvas.cols || windowSize.height != canvas.rows)
+            {
+                windowSize = cv::Size{canvas.cols, canvas.rows};
+                cv::resizeWindow(displayWindowName, windowSize.width, windowSize.height);
+            }
+
+            cv::imshow(displayWindowName, canvas);
+
+            FrameTrace& trace = std::get<Image>(result->labelledImage_).trace;
+
+            trace.displayed = std::chrono::steady_clock::now();
+            stageMetrics.RecordDisplayed(trace);
+        }
+
+        // Handles window events for the rest of the frame interval, which caps the display rate
+        const auto remainingFrameTime = std::chrono::duration_cast<std::chrono::milliseconds>(frameStartTime + frameInterval - std::chrono::steady_clock::now());
+
+        cv::waitKey(std::max<int>(1, static_cast<int>(remainingFrameTime.count())));
 
         // Check window's property in order to determine if window was closed
-        if (cv::getWindowProperty(displayWindowName, cv::WND_PROP_AUTOSIZE) < 0)
+        if (cv::getWindowProperty(displayWindowName, cv::WND_PROP_AUTOSIZE) < 0 || sourceFailed.load(std::memory_order_acquire))
         {
             prmsTerminate.set_value();
             break;
@@ -163,20 +608,282 @@ void ImageDisplayThread(std::promise<void>&& prmsTerminate)
     }
 }
 
-int main() {
+void MetricsExportThread(std::shared_future<void> futTerminate, std::string metricsFilePath, std::chrono::milliseconds exportInterval)
+{
+    do
+    {
+        if (!stageMetrics.ExportPrometheus(metricsFilePath))
+        {
+            std::cerr << "Could not write metrics file: " << metricsFilePath << std::endl;
+        }
+    }
+    while (futTerminate.wait_for(exportInterval) != std::future_status::ready);
+
+    (void)stageMetrics.ExportPrometheus(metricsFilePath);
+}
+
+int main(int argc, char* argv[]) {
     std::cout << "Image Classification" << "\n";
 
+    const auto startupTime = std::chrono::steady_clock::now();
+
+    const Config config = ParseCommandLine(argc, argv);
+
     std::promise<void> prmsTerminate;
 
     std::shared_future<void> futTerminate{prmsTerminate.get_future()};
 
-    std::thread imageCaptureThread{ImageCaptureThread, futTerminate};
-    std::thread inferenceThread{InferenceThread, futTerminate};
-    std::thread imageDisplayThread{ImageDisplayThread, std::move(prmsTerminate)};
+    if (config.tensorCacheBudgetMB > 0)
+    {
+        tensorCache = std::make_unique<TensorCache>(config.tensorCacheBudgetMB * 1024 * 1024);
+    }
+
+    if (config.resultCacheMode != ResultCacheMode::Disabled)
+    {
+        resultCache = std::make_unique<ResultCache>(config.resultCacheMode, config.resultCacheEntries, config.resultCacheDistance);
+    }
+
+    // All sessions of all workers and models run on the thread pools of the registry's environment, inter-op parallelism is not used
+    ModelRegistry registry{static_cast<int>(config.intraOpThreads), 1, config.placement.onnxRuntime};
+
+    RegisterBuiltinModels(registry);
+
+    std::vector<size_t> modelIdxs;
+
+    for (const std::string& modelName : config.modelNames)
+    {
+        std::optional<size_t> modelIdx = registry.Find(modelName);
+
+        if (!modelIdx.has_value())
+        {
+            std::cerr << "Unknown model: " << modelName << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        modelIdxs.push_back(*modelIdx);
+    }
+
+    inputImageScheduler = std::make_unique<FairScheduler<Image>>(modelIdxs.size(), config.inputQueueCapacity, config.inputQueuePolicy);
+
+    std::vector<std::unique_ptr<InferenceWorker>> workers;
+
+    for (int64_t workerIdx = 0; workerIdx < config.nrOfWorkers; workerIdx++)
+    {
+        auto worker = std::make_unique<InferenceWorker>(modelIdxs.size() * config.pipelineDepth);
+
+        // Slot buffers and session allocations of the warm-up are first touched on the node of the worker's inference thread
+        ScopedThreadPlacement placement{SelectCpuList(config.placement.inference, workerIdx)};
+
+        for (const size_t modelIdx : modelIdxs)
+        {
+            auto modelHandler = registry.CreateHandler(modelIdx, config.maxBatchSize);
+
+            modelHandler->BuildPreprocessPipeline(config.preprocessMode);
+            modelHandler->BuildPostprocessor(config.topK);
+
+            std::optional<InGraphPreprocessing> inGraphPreprocessing;
+
+            if (config.preprocessMode == PreprocessMode::InGraph)
+            {
+                inGraphPreprocessing = modelHandler->getInGraphPreprocessing();
+            }
+
+            auto runtime = registry.CreateRuntime();
+
+            runtime->Prepare(modelHandler->getModelPath(), modelHandler->getInputBatches(), config.pipelineDepth, registry.getIntraOpThreads(), inGraphPreprocessing,
+                             RuntimeStartupOptions{config.modelCacheDir, config.warmupRuns});
+
+            std::cout << "Worker " << workerIdx << " " << registry.getName(modelIdx) << " ";
+            runtime->PrintStartupStats();
+
+            auto model = std::make_unique<WorkerModel>(registry.getName(modelIdx), std::move(modelHandler), std::move(runtime), config.pipelineDepth);
+
+            model->slotImages_.resize(model->runtime_->getNrOfSlots());
+            model->slotContentKeys_.resize(model->runtime_->getNrOfSlots());
+
+            for (size_t slotIdx = 0; slotIdx < model->runtime_->getNrOfSlots(); slotIdx++)
+            {
+                model->slotImages_[slotIdx].reserve(model->runtime_->getMaxBatchSize());
+                (void)model->freeSlotQueue_.push(slotIdx);
+            }
+
+            worker->models_.push_back(std::move(model));
+        }
+
+        workers.push_back(std::move(worker));
+    }
+
+    for (const auto& model : workers.front()->models_)
+    {
+        std::cout << "Model: " << model->name_ << "\n";
+        model->runtime_->PrintModelInfo();
+    }
+
+    std::cout << "Inference workers: " << workers.size() << " Models: " << modelIdxs.size() << " Shared intra-op threads: " << registry.getIntraOpThreads() << "\n";
+
+    // Frames captured but not displayed yet: queued per model, batched into the runtime slots of the workers, decoded ahead,
+    // and the ones held by the capture thread, the result mailbox and the display
+    const size_t maxFramesInFlight = modelIdxs.size() * (config.inputQueueCapacity + config.nrOfWorkers * config.pipelineDepth * config.maxBatchSize) + config.readAheadDepth + 3;
+
+    // Postprocessing threads insert into it as soon as they run
+    pendingClassifierResults = std::make_unique<ReorderBuffer<ClassifierResult>>(maxFramesInFlight);
+
+    std::vector<std::thread> workerThreads;
+
+    // Threads inherit the affinity of the thread starting them
+    auto startPinnedThread = [&workerThreads](const CpuList& cpus, auto&&... args)
+    {
+        ScopedThreadPlacement placement{cpus};
+
+        workerThreads.emplace_back(std::forward<decltype(args)>(args)...);
+    };
+
+    for (size_t workerIdx = 0; workerIdx < workers.size(); workerIdx++)
+    {
+        InferenceWorker& worker = *workers[workerIdx];
+
+        startPinnedThread(SelectCpuList(config.placement.preprocess, workerIdx), PreprocessThread, config, std::ref(worker));
+        startPinnedThread(SelectCpuList(config.placement.inference, workerIdx), InferenceThread, std::ref(worker));
+        startPinnedThread(SelectCpuList(config.placement.postprocess, workerIdx), PostprocessThread, std::ref(worker));
+    }
+
+    ImageProviderOptions providerOptions;
+    providerOptions.imagesPath = config.imagesPath;
+    providerOptions.videoPath = config.videoPath;
+    providerOptions.maxFrameAge = config.maxFrameAge;
+    providerOptions.decodeThreads = config.decodeThreads;
+    providerOptions.readAheadDepth = config.readAheadDepth;
+
+    // Reduced decoding has to cover the largest input of all models
+    if (config.reducedDecode)
+    {
+        for (const auto& model : workers.front()->models_)
+        {
+            providerOptions.targetHeight = std::max<int>(providerOptions.targetHeight, model->modelHandler_->getInputHeight());
+            providerOptions.targetWidth = std::max<int>(providerOptions.targetWidth, model->modelHandler_->getInputWidth());
+        }
+    }
+
+    // Kept alive by providerOptions until all threads are joined, images may reference the mapping
+    if (!config.packPath.empty())
+    {
+        providerOptions.packedDataset = std::make_shared<const PackedDataset>(config.packPath);
+    }
+
+    // The frame pool, the decoding threads of the image provider and the capture thread are placed together
+    std::optional<ScopedThreadPlacement> capturePlacement{std::in_place, config.placement.capture};
+
+    // Raw packed frames are referenced in the mapping, only decoded frames need storage
+    if (providerOptions.packedDataset == nullptr || providerOptions.packedDataset->getPayload() == PackPayload::Encoded)
+    {
+        size_t frameCapacity = 0;
+
+        for (size_t entryIdx = 0; providerOptions.packedDataset != nullptr && entryIdx < providerOptions.packedDataset->size(); entryIdx++)
+        {
+            const PackEntry& entry = providerOptions.packedDataset->getEntry(entryIdx);
+
+            frameCapacity = std::max<size_t>(frameCapacity, static_cast<size_t>(entry.height) * entry.width * 3);
+        }
+
+        providerOptions.framePool = std::make_shared<FramePool>(maxFramesInFlight, frameCapacity);
+    }
+
+    // Owns the image list the paths of the images refer to, hence it outlives all threads
+    ImageProvider imgProvider{providerOptions};
+
+    std::cout << "Ready after " << std::chrono::duration<double>(std::chrono::steady_clock::now() - startupTime).count() << "s\n";
+
+    std::thread imageCaptureThread{ImageCaptureThread, futTerminate, config, std::ref(imgProvider), std::cref(registry), modelIdxs};
+
+    capturePlacement.reset();
+
+    std::thread imageDisplayThread;
+
+    {
+        ScopedThreadPlacement displayPlacement{config.placement.display};
+
+        imageDisplayThread = std::thread{ImageDisplayThread, std::move(prmsTerminate), config.maxDisplayFps};
+    }
+    std::thread metricsExportThread;
+
+    if (!config.metricsFilePath.empty())
+    {
+        metricsExportThread = std::thread{MetricsExportThread, futTerminate, config.metricsFilePath, config.metricsExportInterval};
+    }
 
     imageCaptureThread.join();
-    inferenceThread.join();
+
+    inputImageScheduler->close();
+
+    for (auto& workerThread : workerThreads)
+    {
+        workerThread.join();
+    }
+
     imageDisplayThread.join();
 
-    return EXIT_SUCCESS;
+    if (metricsExportThread.joinable())
+    {
+        metricsExportThread.join();
+    }
+
+    for (size_t queueIdx = 0; queueIdx < modelIdxs.size(); queueIdx++)
+    {
+        PrintQueueStats("Input image queue " + registry.getName(modelIdxs[queueIdx]), inputImageScheduler->getStats(queueIdx));
+    }
+
+    const MailboxStats mailboxStats = classifierResultMailbox.getStats();
+
+    std::cout << "Classifier result mailbox: published " << mailboxStats.published << ", displayed " << mailboxStats.taken
+              << ", superseded " << mailboxStats.superseded << "\n";
+
+    std::cout << "Admission control: expired frames " << expiredFrames.load() << ", inference time per frame "
+              << std::chrono::duration<double, std::milli>(inferenceTimePerFrame.get()).count() << "ms, capture interval "
+              << std::chrono::duration<double, std::milli>(CaptureInterval(config)).count() << "ms\n";
+
+    const FrameSourceStats sourceStats = imgProvider.getSourceStats();
+    const double decodeRate = (sourceStats.elapsedSeconds > 0.0) ? sourceStats.decoded / sourceStats.elapsedSeconds : 0.0;
+    const double dropRate = (sourceStats.decoded > 0) ? 100.0 * sourceStats.dropped / sourceStats.decoded : 0.0;
+
+    std::cout << "Frame source: decoded " << sourceStats.decoded << " (" << decodeRate << " frames/s, " << sourceStats.decodeSeconds << "s decoding), dropped "
+              << sourceStats.dropped << " (" << dropRate << "%)\n";
+
+    if (providerOptions.framePool != nullptr)
+    {
+        const FramePoolStats stats = providerOptions.framePool->getStats();
+
+        std::cout << "Frame pool: " << stats.nrOfFrames << " frames, acquired " << stats.acquired << ", exhausted " << stats.exhausted
+                  << ", grown " << stats.grown << "\n";
+    }
+
+    if (tensorCache != nullptr)
+    {
+        const TensorCacheStats stats = tensorCache->getStats();
+
+        std::cout << "Tensor cache: hits " << stats.hits << ", misses " << stats.misses << ", evictions " << stats.evictions
+                  << ", entries " << stats.entries << ", " << stats.bytes << "/" << stats.budgetBytes << " bytes\n";
+    }
+
+    if (resultCache != nullptr)
+    {
+        const ResultCacheStats stats = resultCache->getStats();
+        const uint64_t lookups = stats.hits + stats.misses;
+
+        std::cout << "Result cache: hits " << stats.hits << ", misses " << stats.misses << ", hit rate "
+                  << ((lookups > 0) ? 100.0 * stats.hits / lookups : 0.0) << "%, evictions " << stats.evictions
+                  << ", entries " << stats.entries << "/" << stats.capacity << "\n";
+    }
+
+    if (pendingClassifierResults->getNrOfStale() > 0)
+    {
+        std::cout << "Reorder buffer: ignored " << pendingClassifierResults->getNrOfStale() << " stale results\n";
+    }
+
+    // Undisplayed results may still hold pooled frames, which have to return to the pool before it is destroyed
+    (void)classifierResultMailbox.takeUntil(std::chrono::steady_clock::now());
+    pendingClassifierResults.reset();
+    inputImageScheduler.reset();
+
+    return sourceFailed.load() ? EXIT_FAILURE : EXIT_SUCCESS;
 }
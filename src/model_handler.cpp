@@ -1,51 +1,112 @@
 #include "model_handler.h"
+#include "hash.h"
+#include <filesystem>
 
-static std::ifstream& GoToLine(std::ifstream& ifstrm, size_t line_num)
+void ModelHandler::BuildPostprocessor(size_t topK)
 {
-    ifstrm.seekg(std::ios::beg);
+    std::filesystem::path cwd = std::filesystem::current_path();
+    const std::string absLabelsPath = cwd.string() + getLabels();
+
+    std::ifstream ifstrm{absLabelsPath, std::ios::in};
 
-    for (size_t line_idx = 0; line_idx < line_num; line_idx++)
+    if (!ifstrm.is_open())
     {
-        ifstrm.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::cerr << "Could not open file: " << absLabelsPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
     }
 
-    return ifstrm;
+    labelTable_ = LabelTable{};
+
+    std::string labelStr;
+
+    while (std::getline(ifstrm, labelStr))
+    {
+        labelTable_.Add(extractClassLabel(labelStr));
+    }
+
+    if (static_cast<int64_t>(labelTable_.size()) != getNrOfClasses())
+    {
+        std::cerr << "Expected " << getNrOfClasses() << " labels in " << absLabelsPath << ", found " << labelTable_.size() << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    postprocessor_ = std::make_unique<TopKPostprocessor>(labelTable_, topK);
 }
 
-std::string ModelHandler::Postprocess()
+std::optional<float> ModelHandler::VerifyFusedPreprocess(const Image& img)
 {
-    const std::vector<float>& outputValues = getOutputBuffer();
+    std::vector<float> fusedTensor(getInputSize());
 
-    auto maxScoreItr = std::max_element(outputValues.begin(), outputValues.end());
-    auto predictedClassIdx = std::distance(outputValues.begin(), maxScoreItr);
+    if (fusedPreprocessor_ == nullptr || !fusedPreprocessor_->apply(img, fusedTensor.data()))
+    {
+        return std::nullopt;
+    }
 
-    std::filesystem::path cwd = std::filesystem::current_path();
-    const std::string absLabelsPath = cwd.string() + getLabels();
+    Image referenceImg = img.Borrow();
+    referenceImg.matrix = img.matrix.clone();
 
-    std::ifstream ifstrm{absLabelsPath, std::ios::in};
+    Preprocess(referenceImg);
 
-    if (!ifstrm.is_open())
-    {
-        std::cerr << "Could not open file: " << absLabelsPath << std::endl;
+    const float* referenceTensor = referenceImg.matrix.ptr<float>();
 
-        std::exit(EXIT_FAILURE);
+    float maxDeviation = 0.0f;
+
+    for (size_t valueIdx = 0; valueIdx < fusedTensor.size(); valueIdx++)
+    {
+        maxDeviation = std::max(maxDeviation, std::abs(fusedTensor[valueIdx] - referenceTensor[valueIdx]));
     }
 
-    (void)GoToLine(ifstrm, predictedClassIdx);
+    return maxDeviation;
+}
 
-    std::string labelStr;
+void MobileNetV2ModelHandler::BuildPreprocessPipeline(PreprocessMode mode)
+{
+    if (mode == PreprocessMode::Fused)
+    {
+        fusedPreprocessor_ = std::make_unique<FusedPreprocessor>(inputHeight_, inputWidth_, channelNormParams_);
+    }
 
-    std::getline(ifstrm, labelStr);
+    if (mode == PreprocessMode::InGraph)
+    {
+        // Resized frames are handed over as they are, the rest happens in the preprocessing session
+        ImagePreprocessingPipelineBuilder builder;
+        builder.addResize(inputHeight_, inputWidth_);
+        preprocessingPipeline_ = std::move(builder.build());
+    }
+    else if (mode == PreprocessMode::Static)
+    {
+        // The staged pipeline is the fallback for images the single pass kernel does not handle
+        fusedPreprocessor_ = std::make_unique<StaticFusedClassification<MobileNetV2Descriptor>>();
+        preprocessingPipeline_ = std::make_unique<ImagePreprocessingPipeline>();
+        preprocessingPipeline_->add(std::make_unique<StaticPipelineTransformation<StaticClassificationPipeline<MobileNetV2Descriptor>>>());
+    }
+    else
+    {
+        // The transformation chain is also built in fused mode, it serves as fallback and reference of the fused kernel
+        ImagePreprocessingPipelineBuilder builder;
+        builder.addResize(inputHeight_, inputWidth_);
+        builder.addConvertColor(ColorFormat::RGB);
+        builder.addNormalize(channelNormParams_);
+        builder.addConvertMemLayout(MemoryLayout::CHW);
+        preprocessingPipeline_ = std::move(builder.build());
+    }
 
-    return labelStr;
+    preprocessSignature_ = Fnv1aHash(getModelPath());
+    preprocessSignature_ = Fnv1aHashValue(mode, preprocessSignature_);
+    preprocessSignature_ = Fnv1aHash(channelNormParams_.data(), sizeof(channelNormParams_), preprocessSignature_);
 }
 
-void MobileNetV2ModelHandler::BuildPreprocessPipeline()
+InGraphPreprocessing MobileNetV2ModelHandler::getInGraphPreprocessing() const
 {
-    ImagePreprocessingPipelineBuilder builder;
-    builder.addResize(inputHeight_, inputWidth_);
-    builder.addConvertColor(ColorFormat::RGB);
-    builder.addNormalize(channelNormParams_);
-    builder.addConvertMemLayout(MemoryLayout::CHW);
-    preprocessingPipeline_ = std::move(builder.build());
-}
\ No newline at end of file
+    InGraphPreprocessing preprocessing;
+
+    for (size_t channelIdx = 0; channelIdx < channelNormParams_.size(); channelIdx++)
+    {
+        preprocessing.scale[channelIdx] = 1.0f / (255.0f * channelNormParams_[channelIdx].std);
+        preprocessing.offset[channelIdx] = -channelNormParams_[channelIdx].mean / channelNormParams_[channelIdx].std;
+    }
+
+    return preprocessing;
+}
@@ -2,25 +2,37 @@
 #define MODEL_HANDLER_H_
 
 #include "image_preprocessor.h"
+#include "postprocessor.h"
+#include "static_pipeline.h"
+#include "preprocess_model.h"
 #include <array>
 #include <memory>
 #include <fstream>
 #include <string>
+#include <optional>
+#include <algorithm>
+#include <vector>
+
+enum class ModelPrecision : uint8_t
+{
+    FP32 = 0,
+    // Statically quantized variant (QDQ or QOperator) with float input and output
+    INT8 = 1
+};
 
 class ModelHandler
 {
     public:
     virtual const char* const getModelPath() const = 0;
-    virtual std::vector<float>& getInputBuffer() = 0;
-    virtual std::vector<float>& getOutputBuffer() = 0;
     virtual int64_t getInputHeight() const = 0;
     virtual int64_t getInputWidth() const = 0;
     virtual int64_t getInputChannels() const = 0;
     virtual int64_t getInputBatches() const = 0;
+    int64_t getInputSize() const { return getInputHeight() * getInputWidth() * getInputChannels(); }
     virtual int64_t getNrOfClasses() const = 0;
     virtual const char* const getLabels() const = 0;
     virtual std::string extractClassLabel(const std::string& labelStr) const = 0;
-    virtual void BuildPreprocessPipeline() = 0;
+    virtual void BuildPreprocessPipeline(PreprocessMode mode) = 0;
     void Preprocess(Image& img)
     {
         if (preprocessingPipeline_ != nullptr)
@@ -28,21 +40,72 @@ class ModelHandler
             preprocessingPipeline_->apply(img);
         }
     }
-    virtual std::string Postprocess();
+    // Preprocesses the image straight into the given slice of the input tensor, using the fused kernel if available
+    void Preprocess(Image& img, float* inputTensor)
+    {
+        if (fusedPreprocessor_ != nullptr && fusedPreprocessor_->apply(img, inputTensor))
+        {
+            return;
+        }
+
+        Preprocess(img);
+
+        std::copy_n(img.matrix.ptr<float>(), getInputSize(), inputTensor);
+    }
+    // Resizes the image and copies it as 8 bit BGR HWC frame into the slice of the frame buffer, for in-graph preprocessing
+    void PreprocessFrame(Image& img, uint8_t* frame)
+    {
+        Preprocess(img);
+
+        const size_t rowSize = static_cast<size_t>(img.matrix.cols) * img.matrix.elemSize();
+
+        for (int row = 0; row < img.matrix.rows; row++)
+        {
+            std::copy_n(img.matrix.ptr<uint8_t>(row), rowSize, frame + row * rowSize);
+        }
+    }
+    // Normalization the model expects, to be applied by ONNX Runtime in in-graph preprocessing mode
+    virtual InGraphPreprocessing getInGraphPreprocessing() const = 0;
+    // Maximum absolute deviation of the fused kernel output from the transformation chain output
+    std::optional<float> VerifyFusedPreprocess(const Image& img);
+    // Identifies the preprocessing configuration, images preprocessed with equal signatures result in equal tensors
+    uint64_t getPreprocessSignature() const { return preprocessSignature_; }
+    // Loads the labels once and sets up the selection of the K most probable classes
+    void BuildPostprocessor(size_t topK);
+    void Postprocess(const float* scores, size_t batchSize, std::vector<Prediction>& predictions) { postprocessor_->apply(scores, batchSize, predictions); }
+    const LabelTable& getLabelTable() const noexcept { return labelTable_; }
     virtual ~ModelHandler() = default;
 
     protected:
     std::unique_ptr<ImagePreprocessingPipeline> preprocessingPipeline_;
+    std::unique_ptr<TensorPreprocessor> fusedPreprocessor_;
+    uint64_t preprocessSignature_{0};
+    LabelTable labelTable_;
+    std::unique_ptr<TopKPostprocessor> postprocessor_;
+};
+
+// Compile-time description of the MobileNetV2 input, the static preprocessing pipeline is generated from it
+struct MobileNetV2Descriptor
+{
+    static constexpr int64_t kInputHeight{224};
+    static constexpr int64_t kInputWidth{224};
+    static constexpr int64_t kInputChannels{3};
+    static constexpr std::array<ChannelNormParams, 3> kChannelNormParams
+    {
+        // R-channel
+        ChannelNormParams{0.485, 0.229},
+        // G-channel
+        ChannelNormParams{0.456, 0.224},
+        // B-channel
+        ChannelNormParams{0.406, 0.225}
+    };
 };
 
 class MobileNetV2ModelHandler final : public ModelHandler
 {
     public:
-    MobileNetV2ModelHandler() : inputBuffer_(inputBatches_ * inputHeight_ * inputWidth_ * inputChannels_),
-                                outputBuffer_(inputBatches_ * kClasses_) {}
-    const char* const getModelPath() const override { return modelPath_; }
-    std::vector<float>& getInputBuffer() override { return inputBuffer_; }
-    std::vector<float>& getOutputBuffer() override { return outputBuffer_; }
+    explicit MobileNetV2ModelHandler(int64_t inputBatches = 1, ModelPrecision precision = ModelPrecision::FP32) : inputBatches_{inputBatches}, precision_{precision} {}
+    const char* const getModelPath() const override { return (precision_ == ModelPrecision::INT8) ? int8ModelPath_ : modelPath_; }
     int64_t getInputHeight() const override { return inputHeight_; }
     int64_t getInputWidth() const override { return inputWidth_; }
     int64_t getInputChannels() const override { return inputChannels_; }
@@ -50,29 +113,21 @@ class MobileNetV2ModelHandler final : public ModelHandler
     int64_t getNrOfClasses() const override { return kClasses_; }
     const char* const getLabels() const override { return labelsPath_; }
     std::string extractClassLabel(const std::string& labelStr) const override { return labelStr.substr(labelStr.find(' ') + 1, std::string::npos); }
-    void BuildPreprocessPipeline() override;
-    virtual std::string Postprocess() override { return extractClassLabel(ModelHandler::Postprocess()); }
+    void BuildPreprocessPipeline(PreprocessMode mode) override;
+    InGraphPreprocessing getInGraphPreprocessing() const override;
     constexpr const std::array<ChannelNormParams, 3>& getChannelNormParams() const { return channelNormParams_; }
 
     private:
     static constexpr const char* const modelPath_{"/assets/model/mobilenetv2-12.onnx"};
+    static constexpr const char* const int8ModelPath_{"/assets/model/mobilenetv2-12-int8.onnx"};
     static constexpr const char* const labelsPath_{"/assets/labels/synset.txt"};
-    static constexpr int64_t inputHeight_{224};
-    static constexpr int64_t inputWidth_{224};
-    static constexpr int64_t inputChannels_{3};
-    static constexpr int64_t inputBatches_{1};
+    static constexpr int64_t inputHeight_{MobileNetV2Descriptor::kInputHeight};
+    static constexpr int64_t inputWidth_{MobileNetV2Descriptor::kInputWidth};
+    static constexpr int64_t inputChannels_{MobileNetV2Descriptor::kInputChannels};
     static constexpr int64_t kClasses_{1000};
-    static constexpr std::array<ChannelNormParams, 3> channelNormParams_
-    {
-        // R-channel
-        ChannelNormParams{0.485, 0.229},
-        // G-channel
-        ChannelNormParams{0.456, 0.224},
-        // B-channel
-        ChannelNormParams{0.406, 0.225}
-    };
-    std::vector<float> inputBuffer_;
-    std::vector<float> outputBuffer_;
+    static constexpr const std::array<ChannelNormParams, 3>& channelNormParams_{MobileNetV2Descriptor::kChannelNormParams};
+    int64_t inputBatches_;
+    ModelPrecision precision_;
 };
 
 #endif // #ifndef MODEL_HANDLER_H_
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "model_registry.h"
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <cstdlib>
+
+static Ort::Env CreateEnvironment(int intraOpThreads, int interOpThreads, OrtThreadPlacement& threadPlacement)
+{
+    Ort::ThreadingOptions threadingOptions;
+    threadingOptions.SetGlobalIntraOpNumThreads(intraOpThreads);
+    threadingOptions.SetGlobalInterOpNumThreads(interOpThreads);
+
+    if (!threadPlacement.empty())
+    {
+        threadingOptions.SetGlobalCustomCreateThreadFn(OrtThreadPlacement::CreateThread);
+        threadingOptions.SetGlobalCustomThreadCreationOptions(&threadPlacement);
+        threadingOptions.SetGlobalCustomJoinThreadFn(OrtThreadPlacement::JoinThread);
+    }
+
+    return Ort::Env{threadingOptions, ORT_LOGGING_LEVEL_WARNING, "Icarus"};
+}
+
+ModelRegistry::ModelRegistry(int intraOpThreads, int interOpThreads, CpuList ortThreadCpus)
+    : intraOpThreads_{(intraOpThreads > 0) ? intraOpThreads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))},
+      ortThreadPlacement_{std::move(ortThreadCpus)}, env_{CreateEnvironment(intraOpThreads_, interOpThreads, ortThreadPlacement_)}
+{
+    // Default arena settings, the arena grows on demand and is shared by all sessions instead of one per session
+    Ort::ArenaCfg arenaCfg{0, -1, -1, -1};
+
+    env_.CreateAndRegisterAllocator(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault), arenaCfg);
+
+    sessionResources_.globalThreadPools = true;
+    sessionResources_.environmentAllocator = true;
+    sessionResources_.prepackedWeights = &prepackedWeights_;
+    sessionResources_.optimizedModelCacheKeys = &optimizedModelCacheKeys_;
+}
+
+void ModelRegistry::Register(std::string name, ModelHandlerFactory factory)
+{
+    if (Find(name).has_value())
+    {
+        std::cerr << "Model registered twice: " << name << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    models_.push_back(RegisteredModel{std::move(name), std::move(factory)});
+}
+
+std::optional<size_t> ModelRegistry::Find(std::string_view name) const
+{
+    auto it = std::find_if(models_.cbegin(), models_.cend(), [name](const RegisteredModel& model) { return model.name == name; });
+
+    if (it == models_.cend())
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<size_t>(it - models_.cbegin());
+}
+
+void RegisterBuiltinModels(ModelRegistry& registry)
+{
+    registry.Register("mobilenetv2", [](int64_t inputBatches) { return std::make_unique<MobileNetV2ModelHandler>(inputBatches, ModelPrecision::FP32); });
+    registry.Register("mobilenetv2-int8", [](int64_t inputBatches) { return std::make_unique<MobileNetV2ModelHandler>(inputBatches, ModelPrecision::INT8); });
+}
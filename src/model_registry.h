@@ -0,0 +1,59 @@
+#ifndef MODEL_REGISTRY_H_
+#define MODEL_REGISTRY_H_
+
+#include "model_handler.h"
+#include "runtime.h"
+#include "thread_placement.h"
+#include <onnxruntime_cxx_api.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using ModelHandlerFactory = std::function<std::unique_ptr<ModelHandler>(int64_t inputBatches)>;
+
+// Models that can be served side by side, looked up by name. All sessions created through the registry share one
+// environment with global intra-/inter-op thread pools and a registered CPU arena, and sessions of the same model
+// share their prepacked weights. Adding a model thus adds its weights, but no further thread pools or arenas.
+class ModelRegistry
+{
+    public:
+    // 0 intra-op threads uses all hardware threads. The pool threads are pinned to the given CPUs, one CPU per thread.
+    ModelRegistry(int intraOpThreads, int interOpThreads, CpuList ortThreadCpus = CpuList{});
+    ModelRegistry(const ModelRegistry& other) = delete;
+    ModelRegistry& operator=(const ModelRegistry& other) = delete;
+    void Register(std::string name, ModelHandlerFactory factory);
+    std::optional<size_t> Find(std::string_view name) const;
+    size_t size() const noexcept { return models_.size(); }
+    const std::string& getName(size_t modelIdx) const { return models_[modelIdx].name; }
+    std::unique_ptr<ModelHandler> CreateHandler(size_t modelIdx, int64_t inputBatches) const { return models_[modelIdx].factory(inputBatches); }
+    // The runtime has to be destroyed before the registry
+    std::unique_ptr<Runtime> CreateRuntime() { return std::make_unique<Runtime>(env_, sessionResources_); }
+    int getIntraOpThreads() const noexcept { return intraOpThreads_; }
+
+    private:
+    struct RegisteredModel
+    {
+        std::string name;
+        ModelHandlerFactory factory;
+    };
+
+    int intraOpThreads_;
+    // Referenced by the thread pools of the environment
+    OrtThreadPlacement ortThreadPlacement_;
+    Ort::Env env_;
+    Ort::PrepackedWeightsContainer prepackedWeights_;
+    // Each model file is hashed once for the optimized model cache, not once per worker
+    OptimizedModelCacheKeys optimizedModelCacheKeys_;
+    SharedSessionResources sessionResources_;
+    std::vector<RegisteredModel> models_;
+};
+
+// Registers the models shipped in assets/model: mobilenetv2 and its statically quantized variant mobilenetv2-int8
+void RegisterBuiltinModels(ModelRegistry& registry);
+
+#endif // #ifndef MODEL_REGISTRY_H_
@@ -0,0 +1,194 @@
+#include "packed_dataset.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char kPackMagic[8]{'I', 'C', 'R', 'P', 'A', 'C', 'K', '1'};
+static constexpr uint32_t kPackVersion{1};
+static constexpr size_t kPayloadAlignment{64};
+
+PackedDatasetWriter::PackedDatasetWriter(const std::filesystem::path& packPath, PackPayload payload) : ofstrm_{packPath, std::ios::out | std::ios::binary | std::ios::trunc}, payload_{payload}
+{
+    if (!ofstrm_.is_open())
+    {
+        std::cerr << "Could not open file: " << packPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Placeholder, the final header is written by Finish()
+    const PackHeader header{};
+    ofstrm_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void PackedDatasetWriter::Add(const std::string& name, const void* data, size_t size, uint32_t height, uint32_t width, int64_t modificationTime)
+{
+    const size_t padding = (kPayloadAlignment - static_cast<size_t>(ofstrm_.tellp()) % kPayloadAlignment) % kPayloadAlignment;
+    const std::vector<char> paddingBytes(padding, 0);
+
+    ofstrm_.write(paddingBytes.data(), paddingBytes.size());
+
+    PackEntry entry{};
+    entry.offset = static_cast<uint64_t>(ofstrm_.tellp());
+    entry.size = size;
+    entry.height = height;
+    entry.width = width;
+    entry.nameOffset = static_cast<uint32_t>(names_.size());
+    entry.nameLength = static_cast<uint32_t>(name.size());
+    entry.modificationTime = modificationTime;
+
+    ofstrm_.write(static_cast<const char*>(data), size);
+
+    entries_.push_back(entry);
+    names_ += name;
+}
+
+void PackedDatasetWriter::Finish()
+{
+    PackHeader header{};
+    std::memcpy(header.magic, kPackMagic, sizeof(kPackMagic));
+    header.version = kPackVersion;
+    header.payload = payload_;
+    header.entryCount = entries_.size();
+
+    // Entries are read in place, keep them aligned
+    const size_t padding = (alignof(PackEntry) - static_cast<size_t>(ofstrm_.tellp()) % alignof(PackEntry)) % alignof(PackEntry);
+    const std::vector<char> paddingBytes(padding, 0);
+
+    ofstrm_.write(paddingBytes.data(), paddingBytes.size());
+
+    header.indexOffset = static_cast<uint64_t>(ofstrm_.tellp());
+    ofstrm_.write(reinterpret_cast<const char*>(entries_.data()), entries_.size() * sizeof(PackEntry));
+
+    header.namesOffset = static_cast<uint64_t>(ofstrm_.tellp());
+    ofstrm_.write(names_.data(), names_.size());
+
+    ofstrm_.seekp(0);
+    ofstrm_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofstrm_.close();
+
+    if (ofstrm_.fail())
+    {
+        std::cerr << "Could not write pack file" << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// Overflow-safe check that [offset, offset + size) lies within [0, limit)
+static bool FitsWithin(uint64_t offset, uint64_t size, uint64_t limit)
+{
+    return offset <= limit && size <= limit - offset;
+}
+
+// Every region referenced by an entry has to lie within the mapping, and raw frames have to match their dimensions,
+// otherwise a truncated or corrupt pack would be read out of bounds later on
+static bool ValidEntry(const PackEntry& entry, PackPayload payload, uint64_t payloadsEnd, uint64_t namesSize)
+{
+    if (!FitsWithin(entry.offset, entry.size, payloadsEnd) || !FitsWithin(entry.nameOffset, entry.nameLength, namesSize))
+    {
+        return false;
+    }
+
+    if (payload == PackPayload::RawBGR)
+    {
+        constexpr uint32_t kMaxDimension{static_cast<uint32_t>(std::numeric_limits<int>::max())};
+
+        // Dimensions fit into an int each, so the product cannot overflow 64 bit
+        return entry.height > 0 && entry.width > 0 && entry.height <= kMaxDimension && entry.width <= kMaxDimension &&
+               entry.size == static_cast<uint64_t>(entry.height) * entry.width * 3;
+    }
+
+    return entry.size > 0;
+}
+
+PackedDataset::PackedDataset(const std::filesystem::path& packPath)
+{
+    const int fd = ::open(packPath.c_str(), O_RDONLY);
+
+    if (fd < 0)
+    {
+        std::cerr << "Could not open file: " << packPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    struct stat fileStat{};
+
+    if (::fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(PackHeader))
+    {
+        std::cerr << "Invalid pack file: " << packPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    mappingSize_ = static_cast<size_t>(fileStat.st_size);
+
+    void* mapping = ::mmap(nullptr, mappingSize_, PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after closing the descriptor
+    ::close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "Could not map file: " << packPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Frames are streamed front to back
+    (void)::madvise(mapping, mappingSize_, MADV_SEQUENTIAL);
+
+    base_ = static_cast<const uint8_t*>(mapping);
+    header_ = reinterpret_cast<const PackHeader*>(base_);
+
+    // The index lies between the payloads and the names, which extend to the end of the file
+    const bool validHeader = std::memcmp(header_->magic, kPackMagic, sizeof(kPackMagic)) == 0 && header_->version == kPackVersion &&
+                             (header_->payload == PackPayload::Encoded || header_->payload == PackPayload::RawBGR) &&
+                             header_->entryCount > 0 && header_->indexOffset >= sizeof(PackHeader) && header_->indexOffset % alignof(PackEntry) == 0 &&
+                             header_->namesOffset <= mappingSize_ && header_->indexOffset <= header_->namesOffset &&
+                             header_->entryCount <= (header_->namesOffset - header_->indexOffset) / sizeof(PackEntry);
+
+    if (!validHeader)
+    {
+        std::cerr << "Invalid pack file: " << packPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    entries_ = reinterpret_cast<const PackEntry*>(base_ + header_->indexOffset);
+    names_ = reinterpret_cast<const char*>(base_ + header_->namesOffset);
+
+    for (size_t entryIdx = 0; entryIdx < header_->entryCount; entryIdx++)
+    {
+        if (!ValidEntry(entries_[entryIdx], header_->payload, header_->indexOffset, mappingSize_ - header_->namesOffset))
+        {
+            std::cerr << "Invalid pack file: " << packPath << ", invalid entry " << entryIdx << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+    }
+}
+
+PackedDataset::~PackedDataset()
+{
+    (void)::munmap(const_cast<uint8_t*>(base_), mappingSize_);
+}
+
+void PackedDataset::Prefetch(size_t entryIdx) const
+{
+    static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+
+    const PackEntry& entry = entries_[entryIdx];
+
+    const size_t begin = entry.offset - entry.offset % pageSize;
+    const size_t end = std::min<size_t>(entry.offset + entry.size, mappingSize_);
+
+    (void)::madvise(const_cast<uint8_t*>(base_) + begin, end - begin, MADV_WILLNEED);
+}
@@ -0,0 +1,82 @@
+#ifndef PACKED_DATASET_H_
+#define PACKED_DATASET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Container of many images in one file: header | payloads | entry index | names.
+// Payloads are 64 byte aligned and hold either the encoded file bytes or decoded 8 bit HWC BGR frames.
+enum class PackPayload : uint32_t
+{
+    Encoded = 0,
+    RawBGR = 1
+};
+
+struct PackHeader
+{
+    char magic[8];
+    uint32_t version;
+    PackPayload payload;
+    uint64_t entryCount;
+    uint64_t indexOffset;
+    uint64_t namesOffset;
+};
+
+struct PackEntry
+{
+    uint64_t offset;
+    uint64_t size;
+    // Frame size of raw payloads, 0 for encoded payloads
+    uint32_t height;
+    uint32_t width;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    int64_t modificationTime;
+};
+
+class PackedDatasetWriter
+{
+    public:
+    PackedDatasetWriter(const std::filesystem::path& packPath, PackPayload payload);
+    void Add(const std::string& name, const void* data, size_t size, uint32_t height, uint32_t width, int64_t modificationTime);
+    size_t size() const noexcept { return entries_.size(); }
+    // Writes index and names, the pack is incomplete until this is called
+    void Finish();
+
+    private:
+    std::ofstream ofstrm_;
+    PackPayload payload_;
+    std::vector<PackEntry> entries_;
+    std::string names_;
+};
+
+// Read-only memory mapping of a pack, payloads are accessed in place without copying
+class PackedDataset
+{
+    public:
+    explicit PackedDataset(const std::filesystem::path& packPath);
+    PackedDataset(const PackedDataset& other) = delete;
+    PackedDataset& operator=(const PackedDataset& other) = delete;
+    ~PackedDataset();
+    size_t size() const noexcept { return header_->entryCount; }
+    PackPayload getPayload() const noexcept { return header_->payload; }
+    const PackEntry& getEntry(size_t entryIdx) const noexcept { return entries_[entryIdx]; }
+    const uint8_t* getData(size_t entryIdx) const noexcept { return base_ + entries_[entryIdx].offset; }
+    std::string_view getName(size_t entryIdx) const noexcept { return std::string_view{names_ + entries_[entryIdx].nameOffset, entries_[entryIdx].nameLength}; }
+    // Hints the kernel to start reading the entry's pages ahead of their use
+    void Prefetch(size_t entryIdx) const;
+
+    private:
+    const uint8_t* base_{nullptr};
+    size_t mappingSize_{0};
+    const PackHeader* header_{nullptr};
+    const PackEntry* entries_{nullptr};
+    const char* names_{nullptr};
+};
+
+#endif // #ifndef PACKED_DATASET_H_
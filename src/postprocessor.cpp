@@ -0,0 +1,41 @@
+#include "postprocessor.h"
+#include <numeric>
+
+void TopKPostprocessor::apply(const float* scores, size_t batchSize, std::vector<Prediction>& predictions)
+{
+    const size_t nrOfClasses = labels_.size();
+
+    predictions.resize(batchSize);
+
+    for (size_t batchIdx = 0; batchIdx < batchSize; batchIdx++)
+    {
+        const float* const imageScores = scores + batchIdx * nrOfClasses;
+        const cv::Mat imageScoresView{1, static_cast<int>(nrOfClasses), CV_32F, const_cast<float*>(imageScores)};
+
+        double maxScore = 0.0;
+        cv::minMaxLoc(imageScoresView, nullptr, &maxScore);
+
+        // Shifted by the maximum score to keep the exponentials finite, cv::exp and cv::sum run on OpenCV's SIMD kernels
+        cv::subtract(imageScoresView, cv::Scalar{maxScore}, expScores_);
+        cv::exp(expScores_, expScores_);
+
+        const float invExpSum = static_cast<float>(1.0 / cv::sum(expScores_)[0]);
+
+        // The softmax preserves the order of the scores, hence the selection only needs the raw scores
+        std::iota(classIndices_.begin(), classIndices_.end(), 0);
+        std::partial_sort(classIndices_.begin(), classIndices_.begin() + topK_, classIndices_.end(), [imageScores](uint32_t classIdx1, uint32_t classIdx2)
+        {
+            return imageScores[classIdx1] > imageScores[classIdx2];
+        });
+
+        Prediction& prediction = predictions[batchIdx];
+        prediction.clear();
+
+        for (size_t rankIdx = 0; rankIdx < topK_; rankIdx++)
+        {
+            const uint32_t classIdx = classIndices_[rankIdx];
+
+            prediction.push_back(ClassScore{classIdx, expScores_.ptr<float>()[classIdx] * invExpSum, labels_[classIdx]});
+        }
+    }
+}
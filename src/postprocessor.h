@@ -0,0 +1,84 @@
+#ifndef POSTPROCESSOR_H_
+#define POSTPROCESSOR_H_
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Class labels stored back to back in a single buffer, indexed by class
+class LabelTable
+{
+    public:
+    void Add(std::string_view label)
+    {
+        labels_ += label;
+        labelEnds_.push_back(static_cast<uint32_t>(labels_.size()));
+    }
+    size_t size() const noexcept { return labelEnds_.size(); }
+    std::string_view operator[](size_t classIdx) const noexcept
+    {
+        const uint32_t labelBegin = (classIdx == 0) ? 0 : labelEnds_[classIdx - 1];
+
+        return std::string_view{labels_.data() + labelBegin, labelEnds_[classIdx] - labelBegin};
+    }
+
+    private:
+    std::string labels_;
+    std::vector<uint32_t> labelEnds_;
+};
+
+struct ClassScore
+{
+    size_t classIdx;
+    float probability;
+    // Refers to the label table of the model handler
+    std::string_view label;
+};
+
+// Most probable classes of an image, in descending order of probability. The scores are stored inline,
+// so predictions travel with their frames from postprocessing to the display without heap allocations.
+class Prediction
+{
+    public:
+    static constexpr size_t kMaxTopK{10};
+
+    void clear() noexcept { size_ = 0; }
+    void push_back(const ClassScore& classScore) noexcept { scores_[size_++] = classScore; }
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    const ClassScore& front() const noexcept { return scores_.front(); }
+    ClassScore* begin() noexcept { return scores_.data(); }
+    ClassScore* end() noexcept { return scores_.data() + size_; }
+    const ClassScore* begin() const noexcept { return scores_.data(); }
+    const ClassScore* end() const noexcept { return scores_.data() + size_; }
+    const ClassScore* cbegin() const noexcept { return begin(); }
+    const ClassScore* cend() const noexcept { return end(); }
+
+    private:
+    std::array<ClassScore, kMaxTopK> scores_{};
+    size_t size_{0};
+};
+
+class TopKPostprocessor
+{
+    public:
+    TopKPostprocessor(const LabelTable& labels, size_t topK) : labels_{labels}, topK_{std::min({topK, labels.size(), Prediction::kMaxTopK})}, classIndices_(labels.size()),
+        expScores_{1, static_cast<int>(labels.size()), CV_32F} {}
+    // Applies the softmax to the class scores of every image of the batch and selects their K most probable classes
+    void apply(const float* scores, size_t batchSize, std::vector<Prediction>& predictions);
+    size_t getTopK() const noexcept { return topK_; }
+
+    private:
+    const LabelTable& labels_;
+    const size_t topK_;
+    std::vector<uint32_t> classIndices_;
+    // Exponentials of the shifted scores of the current image
+    cv::Mat expScores_;
+};
+
+#endif // #ifndef POSTPROCESSOR_H_
@@ -0,0 +1,186 @@
+#include "preprocess_model.h"
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// Just enough of the protobuf wire format to serialize the ONNX messages below
+class ProtoWriter
+{
+    public:
+    void Varint(uint32_t field, uint64_t value)
+    {
+        Tag(field, kWireVarint);
+        RawVarint(value);
+    }
+    void Bytes(uint32_t field, std::string_view bytes)
+    {
+        Tag(field, kWireLengthDelimited);
+        RawVarint(bytes.size());
+        buffer_.append(bytes.data(), bytes.size());
+    }
+    void Message(uint32_t field, const ProtoWriter& message) { Bytes(field, message.buffer_); }
+    const std::string& getBuffer() const noexcept { return buffer_; }
+
+    private:
+    static constexpr uint32_t kWireVarint{0};
+    static constexpr uint32_t kWireLengthDelimited{2};
+
+    void Tag(uint32_t field, uint32_t wireType) { RawVarint((static_cast<uint64_t>(field) << 3) | wireType); }
+    void RawVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    std::string buffer_;
+};
+
+// Field numbers and enum values of onnx.proto
+namespace onnx
+{
+    constexpr int64_t kIrVersion{7};
+    constexpr int64_t kOpsetVersion{13};
+
+    constexpr int32_t kFloat{1};
+    constexpr int32_t kUint8{2};
+    constexpr int32_t kInt64{7};
+
+    constexpr int32_t kAttributeInt{2};
+    constexpr int32_t kAttributeInts{7};
+}
+
+template <typename T>
+static ProtoWriter Tensor(const std::string& name, int32_t dataType, const std::vector<T>& values)
+{
+    ProtoWriter tensor;
+    tensor.Varint(1, values.size());
+    tensor.Varint(2, static_cast<uint64_t>(dataType));
+    tensor.Bytes(8, name);
+
+    // raw_data is little endian, like the host
+    std::string rawData(values.size() * sizeof(T), '\0');
+    std::memcpy(rawData.data(), values.data(), rawData.size());
+    tensor.Bytes(9, rawData);
+
+    return tensor;
+}
+
+static ProtoWriter Node(const std::string& opType, const std::vector<std::string>& inputs, const std::string& output, const std::vector<ProtoWriter>& attributes = {})
+{
+    ProtoWriter node;
+
+    for (const std::string& input : inputs)
+    {
+        node.Bytes(1, input);
+    }
+
+    node.Bytes(2, output);
+    node.Bytes(3, output);
+    node.Bytes(4, opType);
+
+    for (const ProtoWriter& attribute : attributes)
+    {
+        node.Message(5, attribute);
+    }
+
+    return node;
+}
+
+static ProtoWriter IntAttribute(const std::string& name, int64_t value)
+{
+    ProtoWriter attribute;
+    attribute.Bytes(1, name);
+    attribute.Varint(3, static_cast<uint64_t>(value));
+    attribute.Varint(20, onnx::kAttributeInt);
+
+    return attribute;
+}
+
+static ProtoWriter IntsAttribute(const std::string& name, const std::vector<int64_t>& values)
+{
+    ProtoWriter attribute;
+    attribute.Bytes(1, name);
+
+    for (int64_t value : values)
+    {
+        attribute.Varint(8, static_cast<uint64_t>(value));
+    }
+
+    attribute.Varint(20, onnx::kAttributeInts);
+
+    return attribute;
+}
+
+// Tensor value info, a dimension of -1 becomes the symbolic batch dimension
+static ProtoWriter ValueInfo(const std::string& name, int32_t elemType, const std::vector<int64_t>& dims)
+{
+    ProtoWriter shape;
+
+    for (int64_t dim : dims)
+    {
+        ProtoWriter dimension;
+
+        if (dim < 0)
+        {
+            dimension.Bytes(2, "batch");
+        }
+        else
+        {
+            dimension.Varint(1, static_cast<uint64_t>(dim));
+        }
+
+        shape.Message(1, dimension);
+    }
+
+    ProtoWriter tensorType;
+    tensorType.Varint(1, static_cast<uint64_t>(elemType));
+    tensorType.Message(2, shape);
+
+    ProtoWriter type;
+    type.Message(1, tensorType);
+
+    ProtoWriter valueInfo;
+    valueInfo.Bytes(1, name);
+    valueInfo.Message(2, type);
+
+    return valueInfo;
+}
+
+std::string BuildPreprocessModel(int64_t height, int64_t width, const InGraphPreprocessing& preprocessing)
+{
+    ProtoWriter graph;
+
+    graph.Message(1, Node("Gather", {"frames", "rgb_indices"}, "frames_rgb", {IntAttribute("axis", 3)}));
+    graph.Message(1, Node("Cast", {"frames_rgb"}, "frames_float", {IntAttribute("to", onnx::kFloat)}));
+    graph.Message(1, Node("Mul", {"frames_float", "scale"}, "scaled"));
+    graph.Message(1, Node("Add", {"scaled", "offset"}, "normalized"));
+    graph.Message(1, Node("Transpose", {"normalized"}, "preprocessed", {IntsAttribute("perm", {0, 3, 1, 2})}));
+    graph.Bytes(2, "icarus_preprocessing");
+
+    const std::vector<float> scale{preprocessing.scale.cbegin(), preprocessing.scale.cend()};
+    const std::vector<float> offset{preprocessing.offset.cbegin(), preprocessing.offset.cend()};
+
+    graph.Message(5, Tensor<int64_t>("rgb_indices", onnx::kInt64, {2, 1, 0}));
+    graph.Message(5, Tensor<float>("scale", onnx::kFloat, scale));
+    graph.Message(5, Tensor<float>("offset", onnx::kFloat, offset));
+
+    graph.Message(11, ValueInfo("frames", onnx::kUint8, {-1, height, width, 3}));
+    graph.Message(12, ValueInfo("preprocessed", onnx::kFloat, {-1, 3, height, width}));
+
+    ProtoWriter opset;
+    opset.Bytes(1, "");
+    opset.Varint(2, onnx::kOpsetVersion);
+
+    ProtoWriter model;
+    model.Varint(1, onnx::kIrVersion);
+    model.Bytes(2, "Icarus");
+    model.Message(7, graph);
+    model.Message(8, opset);
+
+    return model.getBuffer();
+}
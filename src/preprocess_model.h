@@ -0,0 +1,20 @@
+#ifndef PREPROCESS_MODEL_H_
+#define PREPROCESS_MODEL_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Normalization applied by ONNX Runtime in front of the model. Scale and offset are per RGB channel,
+// folding 1/255 scaling and mean/std normalization into value * scale + offset.
+struct InGraphPreprocessing
+{
+    std::array<float, 3> scale;
+    std::array<float, 3> offset;
+};
+
+// Serialized ONNX model (opset 13) taking a batch of 8 bit BGR HWC frames [N, height, width, 3] and producing
+// the normalized float RGB CHW tensor [N, 3, height, width]: Gather (BGR->RGB), Cast, Mul, Add, Transpose.
+std::string BuildPreprocessModel(int64_t height, int64_t width, const InGraphPreprocessing& preprocessing);
+
+#endif // #ifndef PREPROCESS_MODEL_H_
@@ -0,0 +1,97 @@
+#ifndef REORDER_BUFFER_H_
+#define REORDER_BUFFER_H_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Restores the order of values arriving out of sequence. Entries live in a ring indexed by sequence number,
+// which only grows while the distance between the oldest missing and the newest arrived value increases,
+// so that in steady state neither inserting nor releasing allocates. Not thread-safe.
+template <typename T>
+class ReorderBuffer
+{
+    public:
+    explicit ReorderBuffer(size_t capacity) : entries_(std::max<size_t>(capacity, 1)) {}
+
+    // An empty value marks a sequence number that will never carry a value, its successors are not held back by it.
+    // Sequence numbers that were already released are ignored and counted, they would otherwise wrap around the ring.
+    void insert(uint64_t sequenceNr, std::optional<T> value)
+    {
+        assert(sequenceNr >= nextSequenceNr_ && "sequence number already released");
+
+        if (sequenceNr < nextSequenceNr_)
+        {
+            nrOfStale_++;
+            return;
+        }
+
+        if (sequenceNr - nextSequenceNr_ >= entries_.size())
+        {
+            grow(sequenceNr - nextSequenceNr_ + 1);
+        }
+
+        Entry& entry = entries_[sequenceNr % entries_.size()];
+
+        entry.arrived = true;
+        entry.value = std::move(value);
+    }
+
+    // Hands all values that are next in sequence to the consumer
+    template <typename Consumer>
+    void release(Consumer&& consumer)
+    {
+        while (true)
+        {
+            Entry& entry = entries_[nextSequenceNr_ % entries_.size()];
+
+            if (!entry.arrived)
+            {
+                break;
+            }
+
+            if (entry.value.has_value())
+            {
+                consumer(std::move(*entry.value));
+            }
+
+            entry.arrived = false;
+            entry.value.reset();
+            nextSequenceNr_++;
+        }
+    }
+
+    uint64_t getNrOfStale() const
+    {
+        return nrOfStale_;
+    }
+
+    private:
+    struct Entry
+    {
+        bool arrived{false};
+        std::optional<T> value;
+    };
+
+    void grow(size_t minCapacity)
+    {
+        std::vector<Entry> entries(std::max(minCapacity, 2 * entries_.size()));
+
+        for (uint64_t sequenceNr = nextSequenceNr_; sequenceNr < nextSequenceNr_ + entries_.size(); sequenceNr++)
+        {
+            entries[sequenceNr % entries.size()] = std::move(entries_[sequenceNr % entries_.size()]);
+        }
+
+        entries_ = std::move(entries);
+    }
+
+    std::vector<Entry> entries_;
+    uint64_t nextSequenceNr_{0};
+    uint64_t nrOfStale_{0};
+};
+
+#endif // #ifndef REORDER_BUFFER_H_
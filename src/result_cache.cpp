@@ -0,0 +1,262 @@
+#include "result_cache.h"
+#include "hash.h"
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <iterator>
+
+// Difference hash: the frame is reduced to 9x8 luma cells, every bit tells whether a cell is brighter than its right
+// neighbor. Cells are averaged over a sparse grid of at most 8x8 pixels, which keeps the cost independent of the frame size.
+static uint64_t DifferenceHash(const cv::Mat& frame)
+{
+    constexpr int kCellRows{8};
+    constexpr int kCellCols{9};
+    constexpr int kSamplesPerCellAxis{8};
+
+    std::array<uint32_t, kCellRows * kCellCols> cellLuma{};
+
+    for (int cellRow = 0; cellRow < kCellRows; cellRow++)
+    {
+        const int rowBegin = cellRow * frame.rows / kCellRows;
+        const int rowEnd = std::max(rowBegin + 1, (cellRow + 1) * frame.rows / kCellRows);
+        const int rowStep = std::max(1, (rowEnd - rowBegin) / kSamplesPerCellAxis);
+
+        for (int cellCol = 0; cellCol < kCellCols; cellCol++)
+        {
+            const int colBegin = cellCol * frame.cols / kCellCols;
+            const int colEnd = std::max(colBegin + 1, (cellCol + 1) * frame.cols / kCellCols);
+            const int colStep = std::max(1, (colEnd - colBegin) / kSamplesPerCellAxis);
+
+            uint32_t lumaSum = 0;
+            uint32_t nrOfSamples = 0;
+
+            for (int row = rowBegin; row < rowEnd && row < frame.rows; row += rowStep)
+            {
+                const uint8_t* pixels = frame.ptr<uint8_t>(row);
+
+                for (int col = colBegin; col < colEnd && col < frame.cols; col += colStep)
+                {
+                    // Integer approximation of the luma of a BGR pixel
+                    lumaSum += (pixels[3 * col] + 2u * pixels[3 * col + 1] + pixels[3 * col + 2]) / 4u;
+                    nrOfSamples++;
+                }
+            }
+
+            cellLuma[cellRow * kCellCols + cellCol] = (nrOfSamples > 0) ? lumaSum / nrOfSamples : 0;
+        }
+    }
+
+    uint64_t hash = 0;
+
+    for (int cellRow = 0; cellRow < kCellRows; cellRow++)
+    {
+        for (int cellCol = 0; cellCol + 1 < kCellCols; cellCol++)
+        {
+            hash = (hash << 1) | (cellLuma[cellRow * kCellCols + cellCol] > cellLuma[cellRow * kCellCols + cellCol + 1] ? 1u : 0u);
+        }
+    }
+
+    return hash;
+}
+
+static uint64_t PixelHash(const cv::Mat& frame)
+{
+    const size_t rowSize = static_cast<size_t>(frame.cols) * frame.elemSize();
+
+    if (frame.isContinuous())
+    {
+        return WordHash(frame.data, rowSize * frame.rows);
+    }
+
+    uint64_t hash = kFnv1aOffsetBasis;
+
+    for (int row = 0; row < frame.rows; row++)
+    {
+        hash = WordHash(frame.ptr<uint8_t>(row), rowSize, hash);
+    }
+
+    return hash;
+}
+
+// Bands narrower than 4 bits match most entries, scanning all of them is as fast then
+constexpr uint32_t kMaxHammingBands{16};
+
+ResultCache::ResultCache(ResultCacheMode mode, size_t capacity, uint32_t maxDistance) : mode_{mode}, capacity_{capacity}, maxDistance_{maxDistance}
+{
+    if (mode_ == ResultCacheMode::Perceptual && maxDistance_ < kMaxHammingBands)
+    {
+        bandIndex_.resize(maxDistance_ + 1);
+    }
+}
+
+std::optional<uint64_t> ResultCache::ComputeKey(const Image& img) const
+{
+    if (img.matrix.type() != CV_8UC3 || img.layout != MemoryLayout::HWC || img.fmt != ColorFormat::BGR || img.matrix.empty())
+    {
+        return std::nullopt;
+    }
+
+    if (mode_ == ResultCacheMode::Perceptual)
+    {
+        // Independent of the frame size, a rescaled copy of a frame hashes alike
+        return DifferenceHash(img.matrix);
+    }
+
+    return Fnv1aHashValue(img.matrix.rows, Fnv1aHashValue(img.matrix.cols, PixelHash(img.matrix)));
+}
+
+uint64_t ResultCache::IndexKey(uint64_t contentKey, uint64_t modelKey)
+{
+    return Fnv1aHashValue(modelKey, Fnv1aHashValue(contentKey));
+}
+
+uint64_t ResultCache::BandKey(uint64_t contentKey, uint64_t modelKey, size_t bandIdx) const
+{
+    const size_t bandBegin = bandIdx * 64 / bandIndex_.size();
+    const size_t bandEnd = (bandIdx + 1) * 64 / bandIndex_.size();
+    const uint64_t bandMask = (bandEnd - bandBegin < 64) ? (uint64_t{1} << (bandEnd - bandBegin)) - 1 : ~uint64_t{0};
+
+    return Fnv1aHashValue(bandIdx, IndexKey((contentKey >> bandBegin) & bandMask, modelKey));
+}
+
+std::list<ResultCache::Entry>::iterator ResultCache::FindNearest(uint64_t contentKey, uint64_t modelKey)
+{
+    auto nearestIt = entries_.end();
+    size_t nearestDistance = maxDistance_ + 1;
+
+    auto compare = [&](std::list<Entry>::iterator entryIt)
+    {
+        if (entryIt->modelKey != modelKey)
+        {
+            return;
+        }
+
+        const size_t distance = std::bitset<64>{entryIt->contentKey ^ contentKey}.count();
+
+        if (distance < nearestDistance)
+        {
+            nearestIt = entryIt;
+            nearestDistance = distance;
+        }
+    };
+
+    if (bandIndex_.empty())
+    {
+        for (auto entryIt = entries_.begin(); entryIt != entries_.end() && nearestDistance > 0; entryIt++)
+        {
+            compare(entryIt);
+        }
+
+        return nearestIt;
+    }
+
+    for (size_t bandIdx = 0; bandIdx < bandIndex_.size() && nearestDistance > 0; bandIdx++)
+    {
+        const auto [candidateBegin, candidateEnd] = bandIndex_[bandIdx].equal_range(BandKey(contentKey, modelKey, bandIdx));
+
+        for (auto candidateIt = candidateBegin; candidateIt != candidateEnd && nearestDistance > 0; candidateIt++)
+        {
+            compare(candidateIt->second);
+        }
+    }
+
+    return nearestIt;
+}
+
+void ResultCache::Erase(std::list<Entry>::iterator entryIt)
+{
+    for (size_t bandIdx = 0; bandIdx < bandIndex_.size(); bandIdx++)
+    {
+        const auto [candidateBegin, candidateEnd] = bandIndex_[bandIdx].equal_range(BandKey(entryIt->contentKey, entryIt->modelKey, bandIdx));
+
+        for (auto candidateIt = candidateBegin; candidateIt != candidateEnd; candidateIt++)
+        {
+            if (candidateIt->second == entryIt)
+            {
+                bandIndex_[bandIdx].erase(candidateIt);
+                break;
+            }
+        }
+    }
+
+    entryIndex_.erase(IndexKey(entryIt->contentKey, entryIt->modelKey));
+    entries_.erase(entryIt);
+}
+
+bool ResultCache::Lookup(uint64_t contentKey, uint64_t modelKey, Prediction& prediction)
+{
+    std::lock_guard<std::mutex> lgCache{mtxCache_};
+
+    auto entryIt = entries_.end();
+
+    if (mode_ == ResultCacheMode::Perceptual)
+    {
+        entryIt = FindNearest(contentKey, modelKey);
+    }
+    else
+    {
+        auto indexIt = entryIndex_.find(IndexKey(contentKey, modelKey));
+
+        if (indexIt != entryIndex_.end() && indexIt->second->contentKey == contentKey && indexIt->second->modelKey == modelKey)
+        {
+            entryIt = indexIt->second;
+        }
+    }
+
+    if (entryIt == entries_.end())
+    {
+        misses_++;
+
+        return false;
+    }
+
+    hits_++;
+
+    // Move to the front of the LRU list
+    entries_.splice(entries_.begin(), entries_, entryIt);
+
+    prediction = entryIt->prediction;
+
+    return true;
+}
+
+void ResultCache::Insert(uint64_t contentKey, uint64_t modelKey, const Prediction& prediction)
+{
+    if (capacity_ == 0)
+    {
+        return;
+    }
+
+    const uint64_t indexKey = IndexKey(contentKey, modelKey);
+
+    std::lock_guard<std::mutex> lgCache{mtxCache_};
+
+    auto indexIt = entryIndex_.find(indexKey);
+
+    if (indexIt != entryIndex_.end())
+    {
+        // Classified by another worker meanwhile, or a hash collision
+        Erase(indexIt->second);
+    }
+
+    if (entries_.size() >= capacity_)
+    {
+        Erase(std::prev(entries_.end()));
+        evictions_++;
+    }
+
+    entries_.push_front(Entry{contentKey, modelKey, prediction});
+    entryIndex_.emplace(indexKey, entries_.begin());
+
+    for (size_t bandIdx = 0; bandIdx < bandIndex_.size(); bandIdx++)
+    {
+        bandIndex_[bandIdx].emplace(BandKey(contentKey, modelKey, bandIdx), entries_.begin());
+    }
+}
+
+ResultCacheStats ResultCache::getStats() const
+{
+    std::lock_guard<std::mutex> lgCache{mtxCache_};
+
+    return ResultCacheStats{hits_, misses_, evictions_, entries_.size(), capacity_};
+}
@@ -0,0 +1,79 @@
+#ifndef RESULT_CACHE_H_
+#define RESULT_CACHE_H_
+
+#include "image.h"
+#include "postprocessor.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+enum class ResultCacheMode : uint8_t
+{
+    Disabled = 0,
+    // Identical pixels only, keyed by a hash of the decoded frame
+    Exact = 1,
+    // Near-identical frames, keyed by a 64 bit difference hash (dHash) compared by Hamming distance
+    Perceptual = 2
+};
+
+struct ResultCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t capacity;
+};
+
+// LRU cache of the predictions of classified frames, keyed by their pixel content and the model, shared by all workers.
+// A hit skips preprocessing and inference of a frame whose prediction is already known.
+class ResultCache
+{
+    public:
+    ResultCache(ResultCacheMode mode, size_t capacity, uint32_t maxDistance);
+    ResultCache(const ResultCache& other) = delete;
+    ResultCache& operator=(const ResultCache& other) = delete;
+    // Content hash of the frame according to the mode, nothing for frames other than 8 bit BGR HWC
+    std::optional<uint64_t> ComputeKey(const Image& img) const;
+    // Copies the prediction of the same frame (or, in perceptual mode, of the closest frame within the distance threshold)
+    // classified by the same model
+    bool Lookup(uint64_t contentKey, uint64_t modelKey, Prediction& prediction);
+    void Insert(uint64_t contentKey, uint64_t modelKey, const Prediction& prediction);
+    ResultCacheStats getStats() const;
+
+    private:
+    struct Entry
+    {
+        uint64_t contentKey;
+        uint64_t modelKey;
+        Prediction prediction;
+    };
+
+    static uint64_t IndexKey(uint64_t contentKey, uint64_t modelKey);
+    // Key of the bits of the hash that fall into the band, combined with the model
+    uint64_t BandKey(uint64_t contentKey, uint64_t modelKey, size_t bandIdx) const;
+    // Closest entry of the model within the distance threshold, entries_.end() if none
+    std::list<Entry>::iterator FindNearest(uint64_t contentKey, uint64_t modelKey);
+    void Erase(std::list<Entry>::iterator entryIt);
+
+    const ResultCacheMode mode_;
+    const size_t capacity_;
+    const uint32_t maxDistance_;
+    mutable std::mutex mtxCache_;
+    // Most recently used entry first
+    std::list<Entry> entries_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> entryIndex_;
+    // Perceptual mode: the 64 bit hash is split into maxDistance_ + 1 bands, two hashes within the distance threshold agree in at
+    // least one of them. Entries are indexed per band, so a lookup only compares against the entries sharing a band with it.
+    // Empty for thresholds too large for bands of a useful width, all entries are compared then.
+    std::vector<std::unordered_multimap<uint64_t, std::list<Entry>::iterator>> bandIndex_;
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t evictions_{0};
+};
+
+#endif // #ifndef RESULT_CACHE_H_
@@ -1,64 +1,323 @@
 #include "runtime.h"
+#include "hash.h"
+#include <onnxruntime_session_options_config_keys.h>
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <array>
 #include <string>
 #include <filesystem>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
 
-Runtime& Runtime::Instance()
+// Optimization level of the cached graphs. Extended fusions are hardware independent, the layout optimizations of
+// ORT_ENABLE_ALL depend on the instruction set of the host and are applied when the cached graph is loaded.
+static constexpr GraphOptimizationLevel kCachedOptimizationLevel{ORT_ENABLE_EXTENDED};
+
+static double ElapsedSeconds(std::chrono::steady_clock::time_point startTime)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+static uint64_t ComputeOptimizedModelCacheKey(const std::string& modelPath)
+{
+    std::ifstream modelFile{modelPath, std::ios::binary};
+    const std::string modelBytes{std::istreambuf_iterator<char>{modelFile}, std::istreambuf_iterator<char>{}};
+
+    // The optimized graph depends on the model, the ONNX Runtime build that optimized it and the optimization level
+    uint64_t cacheKey = Fnv1aHash(modelBytes);
+    cacheKey = Fnv1aHash(OrtGetApiBase()->GetVersionString(), cacheKey);
+
+    return Fnv1aHashValue(kCachedOptimizationLevel, cacheKey);
+}
+
+uint64_t OptimizedModelCacheKeys::Get(const std::string& modelPath)
+{
+    // Held while hashing, runtimes preparing the same model concurrently wait for the key instead of hashing it again
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    auto it = keys_.find(modelPath);
+
+    if (it == keys_.end())
+    {
+        it = keys_.emplace(modelPath, ComputeOptimizedModelCacheKey(modelPath)).first;
+    }
+
+    return it->second;
+}
+
+Ort::SessionOptions Runtime::CreateSessionOptions(int intraOpThreads) const
 {
-    static Runtime instance;
+    Ort::SessionOptions sessionOptions;
+
+    if (sharedResources_.globalThreadPools)
+    {
+        sessionOptions.DisablePerSessionThreads();
+    }
+    else
+    {
+        sessionOptions.SetIntraOpNumThreads(intraOpThreads);
 
-    return instance;
+        if (sharedResources_.threadPlacement != nullptr && !sharedResources_.threadPlacement->empty())
+        {
+            sessionOptions.SetCustomCreateThreadFn(OrtThreadPlacement::CreateThread);
+            sessionOptions.SetCustomThreadCreationOptions(sharedResources_.threadPlacement);
+            sessionOptions.SetCustomJoinThreadFn(OrtThreadPlacement::JoinThread);
+        }
+    }
+
+    if (sharedResources_.environmentAllocator)
+    {
+        sessionOptions.AddConfigEntry(kOrtSessionOptionsConfigUseEnvAllocators, "1");
+    }
+
+    return sessionOptions;
 }
 
-void Runtime::Prepare(const char* const modelPath, std::vector<float>& inputData, std::vector<float>& outputData, int64_t batchSize = -1)
+Ort::Session Runtime::CreateSession(const std::string& modelPath, const Ort::SessionOptions& sessionOptions)
 {
-    Ort::Env env;
+    if (sharedResources_.prepackedWeights != nullptr)
+    {
+        return Ort::Session{env_, modelPath.c_str(), sessionOptions, *sharedResources_.prepackedWeights};
+    }
+
+    return Ort::Session{env_, modelPath.c_str(), sessionOptions};
+}
+
+std::string Runtime::LookupOptimizedModel(const std::string& modelPath, const std::string& cacheDir, int intraOpThreads)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    const uint64_t cacheKey = (sharedResources_.optimizedModelCacheKeys != nullptr) ? sharedResources_.optimizedModelCacheKeys->Get(modelPath)
+                                                                                   : ComputeOptimizedModelCacheKey(modelPath);
+
+    startupStats_.modelHashSeconds = ElapsedSeconds(startTime);
+
+    std::array<char, 17> cacheKeyHex{};
+    std::snprintf(cacheKeyHex.data(), cacheKeyHex.size(), "%016llx", static_cast<unsigned long long>(cacheKey));
+
+    const std::filesystem::path cachedModelPath = std::filesystem::path{cacheDir} / (std::filesystem::path{modelPath}.stem().string() + "-" + cacheKeyHex.data() + ".onnx");
+
+    std::error_code errorCode;
+
+    if (std::filesystem::exists(cachedModelPath, errorCode))
+    {
+        startupStats_.cacheHit = true;
+
+        return cachedModelPath.string();
+    }
+
+    if (!std::filesystem::create_directories(cacheDir, errorCode) && errorCode)
+    {
+        std::cerr << "Could not create model cache directory, loading the original model: " << cacheDir << std::endl;
+
+        return modelPath;
+    }
+
+    startTime = std::chrono::steady_clock::now();
+
+    // Written under a name of its own and renamed when complete, so that concurrently starting processes never load a partial file
+    const std::string partialModelPath = cachedModelPath.string() + ".tmp" + std::to_string(::getpid());
+
+    Ort::SessionOptions sessionOptions = CreateSessionOptions(intraOpThreads);
+    sessionOptions.SetGraphOptimizationLevel(kCachedOptimizationLevel);
+    sessionOptions.SetOptimizedModelFilePath(partialModelPath.c_str());
+
+    (void)Ort::Session{env_, modelPath.c_str(), sessionOptions};
+
+    std::filesystem::rename(partialModelPath, cachedModelPath, errorCode);
+
+    startupStats_.optimizeSeconds = ElapsedSeconds(startTime);
+
+    if (errorCode)
+    {
+        std::cerr << "Could not write optimized model, loading the original model: " << cachedModelPath << std::endl;
+
+        (void)std::filesystem::remove(partialModelPath, errorCode);
+
+        return modelPath;
+    }
+
+    return cachedModelPath.string();
+}
+
+void Runtime::Prepare(const char* const modelPath, int64_t batchSize, size_t nrOfSlots, int intraOpThreads,
+                      const std::optional<InGraphPreprocessing>& inGraphPreprocessing, const RuntimeStartupOptions& startupOptions)
+{
+    const auto prepareStartTime = std::chrono::steady_clock::now();
+
+    startupStats_ = RuntimeStartupStats{};
+    startupStats_.cacheEnabled = !startupOptions.optimizedModelCacheDir.empty();
 
     std::filesystem::path cwd = std::filesystem::current_path();
 
     std::string absModelPath = cwd.string() + modelPath;
 
-    Ort::Session session{env, absModelPath.c_str(), Ort::SessionOptions{}};
+    // The serving session always applies all optimizations, on top of the cached extended ones if a cache is used
+    const std::string sessionModelPath = startupOptions.optimizedModelCacheDir.empty()
+                                             ? absModelPath : LookupOptimizedModel(absModelPath, startupOptions.optimizedModelCacheDir, intraOpThreads);
+
+    auto startTime = std::chrono::steady_clock::now();
 
-    std::vector<int64_t> inputShape = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
-    std::vector<int64_t> outputShape = session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    Ort::SessionOptions sessionOptions = CreateSessionOptions(intraOpThreads);
 
-    if (inputShape[0] == -1)
+    Ort::Session session = CreateSession(sessionModelPath, sessionOptions);
+
+    startupStats_.sessionSeconds = ElapsedSeconds(startTime);
+    startTime = std::chrono::steady_clock::now();
+
+    auto inputTypeInfo = session.GetInputTypeInfo(0);
+    auto outputTypeInfo = session.GetOutputTypeInfo(0);
+
+    // The slots hold float buffers. Quantized models have to keep float input/output, i.e. quantize/dequantize inside the graph.
+    if (inputTypeInfo.GetTensorTypeAndShapeInfo().GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT ||
+        outputTypeInfo.GetTensorTypeAndShapeInfo().GetElementType() != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT)
     {
-        // Dynamic batch size dimension
-        inputShape[0] = batchSize;
+        std::cerr << "Model input and output have to be float tensors: " << absModelPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
     }
 
-    if (outputShape[0] == -1)
+    std::vector<int64_t> inputShape = inputTypeInfo.GetTensorTypeAndShapeInfo().GetShape();
+    std::vector<int64_t> outputShape = outputTypeInfo.GetTensorTypeAndShapeInfo().GetShape();
+
+    const bool dynamicBatch = (inputShape[0] == -1);
+
+    const int64_t maxBatchSize = dynamicBatch ? batchSize : inputShape[0];
+
+    inputShape[0] = maxBatchSize;
+    outputShape[0] = maxBatchSize;
+
+    auto shapeSize = [](const std::vector<int64_t>& shape)
     {
-        // Dynamic batch size dimension
-        outputShape[0] = batchSize;
-    }
+        return std::accumulate(shape.cbegin() + 1, shape.cend(), static_cast<size_t>(1), std::multiplies<size_t>{});
+    };
+
+    const size_t inputImageSize = shapeSize(inputShape);
+    const size_t outputImageSize = shapeSize(outputShape);
+
+    // Names are looked up once, the bindings below keep the session call free of any lookups
+    Ort::AllocatorWithDefaultOptions allocator;
+
+    std::string inputName{session.GetInputNameAllocated(0, allocator).get()};
+    std::string outputName{session.GetOutputNameAllocated(0, allocator).get()};
 
     auto memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
 
-    auto inputTensor = Ort::Value::CreateTensor<float>(memoryInfo, inputData.data(), inputData.size(), inputShape.data(), inputShape.size());
-    auto outputTensor = Ort::Value::CreateTensor<float>(memoryInfo, outputData.data(), outputData.size(), outputShape.data(), outputShape.size());
+    Ort::Session preprocessSession{nullptr};
+
+    // Input shape [N, 3, H, W]
+    const int64_t frameHeight = inputShape[2];
+    const int64_t frameWidth = inputShape[3];
+    const size_t frameSize = static_cast<size_t>(frameHeight * frameWidth * 3);
+
+    if (inGraphPreprocessing.has_value())
+    {
+        const std::string preprocessModel = BuildPreprocessModel(frameHeight, frameWidth, *inGraphPreprocessing);
+
+        preprocessSession = Ort::Session{env_, preprocessModel.data(), preprocessModel.size(), sessionOptions};
+    }
+
+    std::vector<RuntimeSlot> slots(nrOfSlots);
+
+    for (auto& slot : slots)
+    {
+        slot.inputData_.resize(maxBatchSize * inputImageSize);
+        slot.outputData_.resize(maxBatchSize * outputImageSize);
+
+        // Tensors only wrap the slot buffers, hence binding one per possible batch size up front is cheap
+        // and keeps tensor creation out of the inference path. Fixed batch size models get a single binding.
+        for (int64_t batchIdx = dynamicBatch ? 1 : maxBatchSize; batchIdx <= maxBatchSize; batchIdx++)
+        {
+            std::vector<int64_t> batchInputShape{inputShape};
+            std::vector<int64_t> batchOutputShape{outputShape};
+
+            batchInputShape[0] = batchIdx;
+            batchOutputShape[0] = batchIdx;
+
+            slot.inputTensors_.push_back(Ort::Value::CreateTensor<float>(memoryInfo, slot.inputData_.data(), batchIdx * inputImageSize, batchInputShape.data(), batchInputShape.size()));
+            slot.outputTensors_.push_back(Ort::Value::CreateTensor<float>(memoryInfo, slot.outputData_.data(), batchIdx * outputImageSize, batchOutputShape.data(), batchOutputShape.size()));
+
+            Ort::IoBinding ioBinding{session};
+            ioBinding.BindInput(inputName.c_str(), slot.inputTensors_.back());
+            ioBinding.BindOutput(outputName.c_str(), slot.outputTensors_.back());
+
+            slot.ioBindings_.push_back(std::move(ioBinding));
+
+            if (preprocessSession)
+            {
+                if (slot.frameData_.empty())
+                {
+                    slot.frameData_.resize(maxBatchSize * frameSize);
+                }
+
+                std::vector<int64_t> frameShape{batchIdx, frameHeight, frameWidth, 3};
+
+                slot.frameTensors_.push_back(Ort::Value::CreateTensor<uint8_t>(memoryInfo, slot.frameData_.data(), batchIdx * frameSize, frameShape.data(), frameShape.size()));
+
+                Ort::IoBinding preprocessBinding{preprocessSession};
+                preprocessBinding.BindInput("frames", slot.frameTensors_.back());
+                preprocessBinding.BindOutput("preprocessed", slot.inputTensors_.back());
+
+                slot.preprocessBindings_.push_back(std::move(preprocessBinding));
+            }
+        }
+    }
 
     session_ = std::move(session);
+    preprocessSession_ = std::move(preprocessSession);
     memoryInfo_ = std::move(memoryInfo);
-    inputTensor_ = std::move(inputTensor);
-    outputTensor_ = std::move(outputTensor);
+    inputName_ = std::move(inputName);
+    outputName_ = std::move(outputName);
+    slots_ = std::move(slots);
     inputShape_ = std::move(inputShape);
     outputShape_ = std::move(outputShape);
+    maxBatchSize_ = maxBatchSize;
+
+    startupStats_.bindSeconds = ElapsedSeconds(startTime);
+    startTime = std::chrono::steady_clock::now();
+
+    // Blank full batches through all slots, the first runs initialize kernels, allocate the arena and fault in the buffers
+    for (size_t runIdx = 0; runIdx < startupOptions.warmupRuns; runIdx++)
+    {
+        Execute(runIdx % slots_.size(), maxBatchSize_);
+    }
+
+    startupStats_.warmupSeconds = ElapsedSeconds(startTime);
+    startupStats_.totalSeconds = ElapsedSeconds(prepareStartTime);
 }
 
-void Runtime::Execute()
+void Runtime::Execute(size_t slotIdx, int64_t batchSize)
 {
-    Ort::AllocatorWithDefaultOptions allocator;
+    RuntimeSlot& slot = slots_[slotIdx];
 
-    const auto inputName = session_.GetInputNameAllocated(0, allocator);
-    const auto outputName = session_.GetOutputNameAllocated(0, allocator);
+    // Fixed batch size models hold a single binding and always run the full batch
+    const size_t bindingIdx = std::min(static_cast<size_t>(batchSize), slot.ioBindings_.size()) - 1;
+
+    if (preprocessSession_)
+    {
+        preprocessSession_.Run(runOptions_, slot.preprocessBindings_[bindingIdx]);
+    }
 
-    std::array<const char*, 1> inputNames{inputName.get()};
-    std::array<const char*, 1> outputNames{outputName.get()};
+    session_.Run(runOptions_, slot.ioBindings_[bindingIdx]);
+}
+
+void Runtime::PrintStartupStats() const
+{
+    std::cout << "Startup: total " << startupStats_.totalSeconds << "s";
+
+    if (startupStats_.cacheEnabled)
+    {
+        std::cout << ", model hash " << startupStats_.modelHashSeconds << "s, optimized model cache " << (startupStats_.cacheHit ? "hit" : "miss")
+                  << ", optimization " << startupStats_.optimizeSeconds << "s";
+    }
 
-    session_.Run(Ort::RunOptions{nullptr}, inputNames.data(), &inputTensor_, session_.GetInputCount(), outputNames.data(), &outputTensor_, session_.GetOutputCount());
+    std::cout << ", session " << startupStats_.sessionSeconds << "s, bindings " << startupStats_.bindSeconds << "s, warm-up " << startupStats_.warmupSeconds << "s\n";
 }
 
 void Runtime::PrintModelInfo()
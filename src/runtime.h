@@ -1,30 +1,130 @@
 #ifndef RUNTIME_H_
 #define RUNTIME_H_
 
+#include "preprocess_model.h"
+#include "thread_placement.h"
 #include <onnxruntime_cxx_api.h>
 #include <vector>
+#include <string>
 #include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <mutex>
+#include <unordered_map>
+
+// Input/output buffers of one in-flight batch together with their pre-bound tensors
+class RuntimeSlot
+{
+    public:
+    float* getInputData() noexcept { return inputData_.data(); }
+    const float* getOutputData() const noexcept { return outputData_.data(); }
+    // 8 bit BGR HWC frames of the in-graph preprocessing, empty otherwise
+    uint8_t* getFrameData() noexcept { return frameData_.data(); }
+
+    private:
+    friend class Runtime;
+    std::vector<float> inputData_;
+    std::vector<float> outputData_;
+    // Tensors viewing the slot buffers and their bindings, one per batch size (index: batch size - 1)
+    std::vector<Ort::Value> inputTensors_;
+    std::vector<Ort::Value> outputTensors_;
+    std::vector<Ort::IoBinding> ioBindings_;
+    // In-graph preprocessing writes straight into the input buffer of the model
+    std::vector<uint8_t> frameData_;
+    std::vector<Ort::Value> frameTensors_;
+    std::vector<Ort::IoBinding> preprocessBindings_;
+};
+
+// Optimized model cache keys by model path, so that a model file is read and hashed once instead of on every Prepare()
+class OptimizedModelCacheKeys
+{
+    public:
+    uint64_t Get(const std::string& modelPath);
+
+    private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, uint64_t> keys_;
+};
+
+// Resources of the environment the sessions of a runtime draw on instead of owning their own, see ModelRegistry
+struct SharedSessionResources
+{
+    // Sessions run on the global intra-/inter-op thread pools of the environment, the intra-op thread count passed to Prepare() is ignored
+    bool globalThreadPools{false};
+    // Sessions allocate their intermediate tensors from the CPU arena registered with the environment
+    bool environmentAllocator{false};
+    // Weights prepacked for the CPU kernels are stored once for all sessions loading the same model
+    Ort::PrepackedWeightsContainer* prepackedWeights{nullptr};
+    // Creates the threads of the per-session pools pinned, has to outlive the runtime. Not used with global thread pools.
+    OrtThreadPlacement* threadPlacement{nullptr};
+    // Shares the optimized model cache keys between runtimes, null hashes the model on every Prepare()
+    OptimizedModelCacheKeys* optimizedModelCacheKeys{nullptr};
+};
+
+struct RuntimeStartupOptions
+{
+    // Directory the optimized graphs are cached in, keyed by model hash, ONNX Runtime version and optimization level.
+    // Empty optimizes the original model on every start.
+    std::string optimizedModelCacheDir;
+    // Full batches of blank input run before Prepare() returns, so that the first frames do not pay for kernel and arena initialization
+    size_t warmupRuns{0};
+};
+
+// Time spent in the steps of Prepare()
+struct RuntimeStartupStats
+{
+    bool cacheEnabled{false};
+    bool cacheHit{false};
+    double modelHashSeconds{0.0};
+    // Optimization and serialization of a model missing in the cache
+    double optimizeSeconds{0.0};
+    double sessionSeconds{0.0};
+    double bindSeconds{0.0};
+    double warmupSeconds{0.0};
+    double totalSeconds{0.0};
+};
 
 class Runtime
 {
     public:
+    explicit Runtime(Ort::Env& env, const SharedSessionResources& sharedResources = SharedSessionResources{}) : env_{env}, sharedResources_{sharedResources},
+                                                                                                              session_{nullptr}, preprocessSession_{nullptr}, memoryInfo_{nullptr} {};
     Runtime(const Runtime& other) = delete;
-    Runtime& operator=(const Runtime& other) = delete;	
-    static Runtime& Instance();
-    void Prepare(const char* const modelPath, std::vector<float>& inputData, std::vector<float>& outputData, int64_t batchSize);
-    void Execute();
+    Runtime& operator=(const Runtime& other) = delete;
+    // With in-graph preprocessing the slots take 8 bit BGR HWC frames, which are normalized by a preprocessing session in front of the model
+    void Prepare(const char* const modelPath, int64_t batchSize, size_t nrOfSlots, int intraOpThreads,
+                 const std::optional<InGraphPreprocessing>& inGraphPreprocessing = std::nullopt,
+                 const RuntimeStartupOptions& startupOptions = RuntimeStartupOptions{});
+    void Execute(size_t slotIdx, int64_t batchSize = 1);
+    RuntimeSlot& getSlot(size_t slotIdx) noexcept {return slots_[slotIdx];}
+    size_t getNrOfSlots() const noexcept {return slots_.size();}
     const std::vector<int64_t>& getInputShape() const noexcept {return inputShape_;}
+    int64_t getMaxBatchSize() const noexcept {return maxBatchSize_;}
     const std::vector<int64_t>& getOutputShape() const noexcept {return outputShape_;}
     void PrintModelInfo();
+    const RuntimeStartupStats& getStartupStats() const noexcept { return startupStats_; }
+    void PrintStartupStats() const;
 
     private:
-    Runtime() : session_{nullptr}, memoryInfo_{nullptr}, inputTensor_{nullptr}, outputTensor_{nullptr} {};
+    Ort::SessionOptions CreateSessionOptions(int intraOpThreads) const;
+    Ort::Session CreateSession(const std::string& modelPath, const Ort::SessionOptions& sessionOptions);
+    // Path of the cached optimized graph of the model, which is optimized and written first if missing. Falls back to the original model path.
+    std::string LookupOptimizedModel(const std::string& modelPath, const std::string& cacheDir, int intraOpThreads);
+
+    // Environment shared by all runtimes of the process, it has to outlive the session
+    Ort::Env& env_;
+    SharedSessionResources sharedResources_;
     Ort::Session session_;
+    Ort::Session preprocessSession_;
     Ort::MemoryInfo memoryInfo_;
-    Ort::Value inputTensor_;
-    Ort::Value outputTensor_;
+    Ort::RunOptions runOptions_;
+    std::string inputName_;
+    std::string outputName_;
+    std::vector<RuntimeSlot> slots_;
     std::vector<int64_t> inputShape_;
     std::vector<int64_t> outputShape_;
+    int64_t maxBatchSize_{1};
+    RuntimeStartupStats startupStats_;
 };
 
 #endif // #ifndef RUNTIME_H_
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "shared_frame_ring.h"
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint8_t* MapRing(int fd, size_t mappingSize)
+{
+    void* mapping = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    return (mapping == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(mapping);
+}
+
+std::unique_ptr<SharedFrameRing> SharedFrameRing::Create(size_t nrOfSlots, size_t slotSize)
+{
+    const int fd = ::memfd_create("icarus-frame-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    // Sealed against resizing, the server refuses rings that could shrink below its mapping and raise SIGBUS on access
+    uint8_t* base = (::ftruncate(fd, static_cast<off_t>(nrOfSlots * slotSize)) == 0 && ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) == 0)
+                        ? MapRing(fd, nrOfSlots * slotSize) : nullptr;
+
+    if (base == nullptr)
+    {
+        (void)::close(fd);
+
+        return nullptr;
+    }
+
+    return std::unique_ptr<SharedFrameRing>{new SharedFrameRing{fd, base, nrOfSlots, slotSize}};
+}
+
+std::unique_ptr<SharedFrameRing> SharedFrameRing::Attach(int fd, size_t nrOfSlots, size_t slotSize)
+{
+    struct stat fileStat{};
+
+    const bool validSize = (nrOfSlots > 0 && slotSize > 0 && nrOfSlots <= std::numeric_limits<size_t>::max() / slotSize);
+    const int seals = ::fcntl(fd, F_GET_SEALS);
+
+    // A client announcing more than it allocated, or able to shrink the ring later on, would make the server access pages beyond its end
+    uint8_t* base = (validSize && seals >= 0 && (seals & F_SEAL_SHRINK) != 0 && ::fstat(fd, &fileStat) == 0 &&
+                     static_cast<size_t>(fileStat.st_size) >= nrOfSlots * slotSize)
+                        ? MapRing(fd, nrOfSlots * slotSize) : nullptr;
+
+    if (base == nullptr)
+    {
+        (void)::close(fd);
+
+        return nullptr;
+    }
+
+    return std::unique_ptr<SharedFrameRing>{new SharedFrameRing{fd, base, nrOfSlots, slotSize}};
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    (void)::munmap(base_, nrOfSlots_ * slotSize_);
+    (void)::close(fd_);
+}
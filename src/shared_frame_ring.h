@@ -0,0 +1,35 @@
+#ifndef SHARED_FRAME_RING_H_
+#define SHARED_FRAME_RING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fixed size frame slots in an anonymous memory file shared by a client and Icarus_server. The client creates the ring
+// and passes its file descriptor over the socket when connecting. A slot belongs to the server from the request referring
+// to it until the response, so the ring itself needs no synchronization and frames are never copied over the socket.
+class SharedFrameRing
+{
+    public:
+    // Creates the ring on the client side, returns nullptr on failure
+    static std::unique_ptr<SharedFrameRing> Create(size_t nrOfSlots, size_t slotSize);
+    // Maps a ring received from a client, taking ownership of the descriptor. Returns nullptr if the memory file is smaller than announced.
+    static std::unique_ptr<SharedFrameRing> Attach(int fd, size_t nrOfSlots, size_t slotSize);
+    SharedFrameRing(const SharedFrameRing& other) = delete;
+    SharedFrameRing& operator=(const SharedFrameRing& other) = delete;
+    ~SharedFrameRing();
+    uint8_t* getSlot(size_t slotIdx) noexcept { return base_ + slotIdx * slotSize_; }
+    size_t getNrOfSlots() const noexcept { return nrOfSlots_; }
+    size_t getSlotSize() const noexcept { return slotSize_; }
+    int getFd() const noexcept { return fd_; }
+
+    private:
+    SharedFrameRing(int fd, uint8_t* base, size_t nrOfSlots, size_t slotSize) : fd_{fd}, base_{base}, nrOfSlots_{nrOfSlots}, slotSize_{slotSize} {}
+
+    int fd_;
+    uint8_t* base_;
+    size_t nrOfSlots_;
+    size_t slotSize_;
+};
+
+#endif // #ifndef SHARED_FRAME_RING_H_
@@ -0,0 +1,117 @@
+#include "stage_metrics.h"
+#include <cstdio>
+#include <fstream>
+
+static constexpr std::array<const char*, static_cast<size_t>(PipelineStage::NrOfStages)> kStageNames
+{
+    "capture", "decode", "queue_wait", "preprocess", "inference", "postprocess", "display", "end_to_end"
+};
+
+static constexpr std::array<double, 4> kExportedQuantiles{0.5, 0.95, 0.99, 0.999};
+
+void StageMetrics::Record(PipelineStage stage, FrameTrace::TimePoint startTime, FrameTrace::TimePoint endTime) noexcept
+{
+    // Stage not passed by the frame
+    if (startTime == FrameTrace::TimePoint{} || endTime < startTime)
+    {
+        return;
+    }
+
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+
+    histograms_[static_cast<size_t>(stage)].Record(static_cast<uint64_t>(latency.count()));
+}
+
+void StageMetrics::RecordProcessed(const FrameTrace& trace) noexcept
+{
+    Record(PipelineStage::Capture, trace.captureStart, trace.captureEnd);
+    Record(PipelineStage::Decode, trace.decodeStart, trace.decodeEnd);
+    Record(PipelineStage::QueueWait, trace.captureEnd, trace.preprocessStart);
+    Record(PipelineStage::Preprocess, trace.preprocessStart, trace.preprocessEnd);
+    Record(PipelineStage::Inference, trace.inferenceStart, trace.inferenceEnd);
+    Record(PipelineStage::Postprocess, trace.inferenceEnd, trace.postprocessEnd);
+}
+
+void StageMetrics::RecordDisplayed(const FrameTrace& trace) noexcept
+{
+    Record(PipelineStage::Display, trace.postprocessEnd, trace.displayed);
+    Record(PipelineStage::EndToEnd, trace.captureStart, trace.displayed);
+}
+
+void StageMetrics::WritePrometheus(std::ostream& ostrm) const
+{
+    ostrm << "# HELP icarus_stage_latency_seconds Latency of the pipeline stages per frame\n"
+          << "# TYPE icarus_stage_latency_seconds histogram\n";
+
+    std::array<LatencyHistogramSnapshot, static_cast<size_t>(PipelineStage::NrOfStages)> snapshots;
+
+    for (size_t stageIdx = 0; stageIdx < histograms_.size(); stageIdx++)
+    {
+        snapshots[stageIdx] = histograms_[stageIdx].getSnapshot();
+
+        const LatencyHistogramSnapshot& snapshot = snapshots[stageIdx];
+
+        // Exported at the power of two boundaries only, which coincide with bucket boundaries and keep the series set stable
+        uint64_t cumulativeCount = 0;
+        size_t bucketIdx = 0;
+
+        for (unsigned magnitude = 0; magnitude < LatencyHistogram::kMaxMagnitude; magnitude++)
+        {
+            const uint64_t upperBoundUs = (uint64_t{1} << (magnitude + 1)) - 1;
+
+            while (bucketIdx < snapshot.counts.size() && LatencyHistogram::BucketUpperBound(bucketIdx) <= upperBoundUs)
+            {
+                cumulativeCount += snapshot.counts[bucketIdx++];
+            }
+
+            ostrm << "icarus_stage_latency_seconds_bucket{stage=\"" << kStageNames[stageIdx] << "\",le=\"" << (upperBoundUs + 1) * 1e-6 << "\"} "
+                  << cumulativeCount << "\n";
+        }
+
+        // The total is summed from the same bucket counts instead of taken from snapshot.count, which a concurrent Record
+        // increments only after the bucket, so +Inf never falls below the last finite bucket
+        for (; bucketIdx < snapshot.counts.size(); bucketIdx++)
+        {
+            cumulativeCount += snapshot.counts[bucketIdx];
+        }
+
+        ostrm << "icarus_stage_latency_seconds_bucket{stage=\"" << kStageNames[stageIdx] << "\",le=\"+Inf\"} " << cumulativeCount << "\n"
+              << "icarus_stage_latency_seconds_sum{stage=\"" << kStageNames[stageIdx] << "\"} " << snapshot.sumUs * 1e-6 << "\n"
+              << "icarus_stage_latency_seconds_count{stage=\"" << kStageNames[stageIdx] << "\"} " << cumulativeCount << "\n";
+    }
+
+    ostrm << "# HELP icarus_stage_latency_quantile_seconds Latency quantiles of the pipeline stages since start, from the full resolution histograms\n"
+          << "# TYPE icarus_stage_latency_quantile_seconds gauge\n";
+
+    for (size_t stageIdx = 0; stageIdx < snapshots.size(); stageIdx++)
+    {
+        for (double quantile : kExportedQuantiles)
+        {
+            ostrm << "icarus_stage_latency_quantile_seconds{stage=\"" << kStageNames[stageIdx] << "\",quantile=\"" << quantile << "\"} "
+                  << snapshots[stageIdx].ValueAtQuantile(quantile) * 1e-6 << "\n";
+        }
+    }
+}
+
+bool StageMetrics::ExportPrometheus(const std::string& filePath) const
+{
+    const std::string tmpFilePath = filePath + ".tmp";
+
+    {
+        std::ofstream ofstrm{tmpFilePath, std::ios::out | std::ios::trunc};
+
+        if (!ofstrm.is_open())
+        {
+            return false;
+        }
+
+        WritePrometheus(ofstrm);
+
+        if (!ofstrm.good())
+        {
+            return false;
+        }
+    }
+
+    return std::rename(tmpFilePath.c_str(), filePath.c_str()) == 0;
+}
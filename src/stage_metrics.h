@@ -0,0 +1,44 @@
+#ifndef STAGE_METRICS_H_
+#define STAGE_METRICS_H_
+
+#include "latency_histogram.h"
+#include "image.h"
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+enum class PipelineStage : size_t
+{
+    // Obtaining the frame from the provider, including decoding or waiting for the read-ahead
+    Capture = 0,
+    Decode = 1,
+    // From the input queue up to the start of preprocessing, including batch collection
+    QueueWait = 2,
+    Preprocess = 3,
+    Inference = 4,
+    Postprocess = 5,
+    // From the end of postprocessing until the frame was shown
+    Display = 6,
+    EndToEnd = 7,
+    NrOfStages = 8
+};
+
+// Latency histograms of all pipeline stages, fed from the frame traces by the stage threads
+class StageMetrics
+{
+    public:
+    void Record(PipelineStage stage, FrameTrace::TimePoint startTime, FrameTrace::TimePoint endTime) noexcept;
+    // Records all stages up to postprocessing
+    void RecordProcessed(const FrameTrace& trace) noexcept;
+    void RecordDisplayed(const FrameTrace& trace) noexcept;
+    // Prometheus text exposition format
+    void WritePrometheus(std::ostream& ostrm) const;
+    // Writes a temporary file and renames it over the target, so scrapers never read a partial file
+    bool ExportPrometheus(const std::string& filePath) const;
+
+    private:
+    std::array<LatencyHistogram, static_cast<size_t>(PipelineStage::NrOfStages)> histograms_;
+};
+
+#endif // #ifndef STAGE_METRICS_H_
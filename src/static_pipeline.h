@@ -0,0 +1,219 @@
+#ifndef STATIC_PIPELINE_H_
+#define STATIC_PIPELINE_H_
+
+#include "image_preprocessor.h"
+#include "fused_preprocessor.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+
+// Compile-time counterparts of the preprocessing transformations, generated from a model descriptor.
+// StaticFusedClassification does resize, BGR->RGB swap, normalization and the CHW write in one pass with the input size and the
+// normalization coefficients as template arguments. The staged StaticPipeline runs one pass per stage, each stage writing into
+// a buffer it owns and reuses across calls, it is the fallback for images the single pass kernel does not handle.
+// A model descriptor is a type providing kInputHeight, kInputWidth, kInputChannels and kChannelNormParams as static constexpr members.
+
+// Normalization coefficients of a model descriptor, computed at compile time
+template <typename ModelDescriptor>
+struct DescriptorNormCoefficients
+{
+    static_assert(ModelDescriptor::kInputChannels == 3, "Normalization expects three channel images");
+
+    static constexpr NormCoefficients kNormCoefficients{MakeNormCoefficients(ModelDescriptor::kChannelNormParams)};
+};
+
+// Shrinks dimensions exceeding the target and pads dimensions falling short of it, like ResizeTransformation
+template <int Height, int Width>
+class StaticResize
+{
+    public:
+    void apply(Image& image)
+    {
+        if (image.height == Height && image.width == Width)
+        {
+            return;
+        }
+
+        const int shrunkHeight = std::min(Height, image.height);
+        const int shrunkWidth = std::min(Width, image.width);
+
+        if (shrunkHeight < image.height || shrunkWidth < image.width)
+        {
+            cv::resize(image.matrix, shrunk_, cv::Size(shrunkWidth, shrunkHeight), 0.0, 0.0, cv::InterpolationFlags::INTER_AREA);
+            image.matrix = shrunk_;
+        }
+
+        if (Height > shrunkHeight || Width > shrunkWidth)
+        {
+            const int borderTop = static_cast<int>(std::round((Height - shrunkHeight) / 2.0f));
+            const int borderLeft = static_cast<int>(std::round((Width - shrunkWidth) / 2.0f));
+
+            cv::copyMakeBorder(image.matrix, padded_, borderTop, Height - shrunkHeight - borderTop, borderLeft, Width - shrunkWidth - borderLeft,
+                               cv::BorderTypes::BORDER_CONSTANT, cv::Scalar{0, 0, 0});
+            image.matrix = padded_;
+        }
+
+        image.height = Height;
+        image.width = Width;
+    }
+
+    private:
+    cv::Mat shrunk_;
+    cv::Mat padded_;
+};
+
+template <ColorFormat ColorFmt>
+class StaticConvertColor
+{
+    public:
+    void apply(Image& image)
+    {
+        // Out of place, the source pixels may be shared with the displayed copy or be a read-only mapping
+        if constexpr (ColorFmt == ColorFormat::RGB)
+        {
+            if (image.fmt == ColorFormat::BGR)
+            {
+                cv::cvtColor(image.matrix, converted_, cv::ColorConversionCodes::COLOR_BGR2RGB);
+                image.matrix = converted_;
+                image.fmt = ColorFormat::RGB;
+            }
+        }
+    }
+
+    private:
+    cv::Mat converted_;
+};
+
+// Scaling to [0, 1] and mean/std normalization folded into one multiply-add per value with constant coefficients
+template <typename ModelDescriptor>
+class StaticNormalize
+{
+    public:
+    static constexpr const NormCoefficients& kNormCoefficients{DescriptorNormCoefficients<ModelDescriptor>::kNormCoefficients};
+
+    // Normalizes the 8 bit three channel image into dst, which has to hold rows * cols * 3 values in the same order
+    static void normalize(const cv::Mat& src, float* dst)
+    {
+        for (int row = 0; row < src.rows; row++)
+        {
+            const uint8_t* srcRow = src.ptr<uint8_t>(row);
+            float* dstRow = dst + static_cast<size_t>(row) * src.cols * 3;
+
+            for (int col = 0; col < src.cols; col++)
+            {
+                for (int channelIdx = 0; channelIdx < 3; channelIdx++)
+                {
+                    dstRow[3 * col + channelIdx] = srcRow[3 * col + channelIdx] * kNormCoefficients.scale[channelIdx] + kNormCoefficients.offset[channelIdx];
+                }
+            }
+        }
+    }
+
+    void apply(Image& image)
+    {
+        if (image.matrix.type() != CV_8UC3)
+        {
+            NormalizeTransformation{ModelDescriptor::kChannelNormParams}.apply(image);
+
+            return;
+        }
+
+        normalized_.create(image.matrix.rows, image.matrix.cols, CV_32FC3);
+        normalize(image.matrix, normalized_.ptr<float>());
+        image.matrix = normalized_;
+    }
+
+    private:
+    cv::Mat normalized_;
+};
+
+template <MemoryLayout MemLayout>
+class StaticConvertMemoryLayout
+{
+    public:
+    void apply(Image& image)
+    {
+        if constexpr (MemLayout == MemoryLayout::CHW)
+        {
+            if (image.layout != MemoryLayout::HWC)
+            {
+                return;
+            }
+
+            if (image.matrix.type() != CV_32FC3)
+            {
+                ConvertMemoryLayoutTransformation{MemLayout}.apply(image);
+
+                return;
+            }
+
+            // Same shape as the blob of cv::dnn::blobFromImage, the planes are views into it that cv::split fills in place
+            const int rows = image.matrix.rows;
+            const int cols = image.matrix.cols;
+            const int blobSize[]{1, 3, rows, cols};
+
+            blob_.create(4, blobSize, CV_32F);
+
+            std::array<cv::Mat, 3> planes;
+
+            for (int channelIdx = 0; channelIdx < 3; channelIdx++)
+            {
+                planes[channelIdx] = cv::Mat{rows, cols, CV_32F, blob_.ptr<float>() + static_cast<size_t>(channelIdx) * rows * cols};
+            }
+
+            cv::split(image.matrix, planes.data());
+            image.matrix = blob_;
+            image.layout = MemoryLayout::CHW;
+        }
+    }
+
+    private:
+    cv::Mat blob_;
+};
+
+template <typename... Stages>
+class StaticPipeline
+{
+    public:
+    void apply(Image& image)
+    {
+        std::apply([&image](auto&... stages) { (stages.apply(image), ...); }, stages_);
+    }
+
+    private:
+    std::tuple<Stages...> stages_;
+};
+
+// Standard classification preprocessing, fully determined by the model descriptor
+template <typename ModelDescriptor>
+using StaticClassificationPipeline = StaticPipeline<StaticResize<ModelDescriptor::kInputHeight, ModelDescriptor::kInputWidth>,
+                                                    StaticConvertColor<ColorFormat::RGB>,
+                                                    StaticNormalize<ModelDescriptor>,
+                                                    StaticConvertMemoryLayout<MemoryLayout::CHW>>;
+
+// Single pass classification preprocessing, the fused kernel specialized for the input size and normalization of the model descriptor
+template <typename ModelDescriptor>
+class StaticFusedClassification final : public TensorPreprocessor
+{
+    public:
+    bool apply(const Image& image, float* tensor) override { return kernel_.apply(image, tensor); }
+
+    private:
+    BasicFusedPreprocessor<ModelDescriptor::kInputHeight, ModelDescriptor::kInputWidth, DescriptorNormCoefficients<ModelDescriptor>> kernel_;
+};
+
+// Adapts a static pipeline to the dynamic pipeline, the whole chain costs a single virtual call
+template <typename Pipeline>
+class StaticPipelineTransformation final : public ImageTransformation
+{
+    public:
+    void apply(Image& image) const override { pipeline_.apply(image); }
+
+    private:
+    // Holds the stage buffers, like the fused kernel it is used by one preprocessing thread at a time
+    mutable Pipeline pipeline_;
+};
+
+#endif // #ifndef STATIC_PIPELINE_H_
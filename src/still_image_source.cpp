@@ -0,0 +1,335 @@
+#include "still_image_source.h"
+#include "allocation_counter.h"
+#include <opencv2/dnn/dnn.hpp>
+#include <cmath>
+#include <cerrno>
+#include <algorithm>
+#include <optional>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Reads the frame size from the start of frame segment of a JPEG stream without decoding it
+static std::optional<cv::Size> ReadJpegSize(const uchar* data, size_t size)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+    {
+        return std::nullopt;
+    }
+
+    size_t pos = 2;
+
+    while (pos + 4 <= size)
+    {
+        if (data[pos] != 0xFF)
+        {
+            return std::nullopt;
+        }
+
+        const uchar marker = data[pos + 1];
+
+        // Fill bytes and markers without payload
+        if (marker == 0xFF)
+        {
+            pos++;
+            continue;
+        }
+
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+        {
+            pos += 2;
+            continue;
+        }
+
+        // Start of scan, no frame header found before the entropy coded data
+        if (marker == 0xDA)
+        {
+            return std::nullopt;
+        }
+
+        const size_t segmentLength = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+
+        const bool startOfFrame = (marker >= 0xC0 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+
+        if (startOfFrame)
+        {
+            if (pos + 9 > size)
+            {
+                return std::nullopt;
+            }
+
+            const int height = (data[pos + 5] << 8) | data[pos + 6];
+            const int width = (data[pos + 7] << 8) | data[pos + 8];
+
+            return cv::Size{width, height};
+        }
+
+        pos += 2 + segmentLength;
+    }
+
+    return std::nullopt;
+}
+
+// Reads the whole file into the buffer, which is only enlarged if the file does not fit. Returns the file size, 0 on errors.
+static size_t ReadFile(const std::filesystem::path& filePath, std::vector<uchar>& buffer)
+{
+    const int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    struct stat fileStatus{};
+
+    size_t size = (::fstat(fd, &fileStatus) == 0) ? static_cast<size_t>(fileStatus.st_size) : 0;
+
+    if (buffer.size() < size)
+    {
+        buffer.resize(size);
+    }
+
+    size_t readSize = 0;
+
+    while (readSize < size)
+    {
+        const ssize_t bytesRead = ::read(fd, buffer.data() + readSize, size - readSize);
+
+        if (bytesRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (bytesRead <= 0)
+        {
+            size = 0;
+            break;
+        }
+
+        readSize += static_cast<size_t>(bytesRead);
+    }
+
+    (void)::close(fd);
+
+    return size;
+}
+
+// Largest reduction factor that still results in an image covering the target size.
+// libjpeg scales each dimension to ceil(size / factor).
+static int SelectReductionFactor(const cv::Size& imageSize, int targetHeight, int targetWidth)
+{
+    for (int factor : {8, 4, 2})
+    {
+        const int reducedHeight = (imageSize.height + factor - 1) / factor;
+        const int reducedWidth = (imageSize.width + factor - 1) / factor;
+
+        if (reducedHeight >= targetHeight && reducedWidth >= targetWidth)
+        {
+            return factor;
+        }
+    }
+
+    return 1;
+}
+
+cv::Mat StillImageSource::DecodeImage(const uchar* encodedImage, size_t size, FrameHandle& frame) const
+{
+    int imreadMode = cv::ImreadModes::IMREAD_COLOR;
+    int reductionFactor = 1;
+
+    if (size == 0)
+    {
+        return cv::Mat{};
+    }
+
+    auto jpegSize = ReadJpegSize(encodedImage, size);
+
+    if (jpegSize.has_value() && options_.targetHeight > 0 && options_.targetWidth > 0)
+    {
+        reductionFactor = SelectReductionFactor(*jpegSize, options_.targetHeight, options_.targetWidth);
+
+        switch (reductionFactor)
+        {
+            case 8:
+            {
+                imreadMode = cv::ImreadModes::IMREAD_REDUCED_COLOR_8;
+                break;
+            }
+            case 4:
+            {
+                imreadMode = cv::ImreadModes::IMREAD_REDUCED_COLOR_4;
+                break;
+            }
+            case 2:
+            {
+                imreadMode = cv::ImreadModes::IMREAD_REDUCED_COLOR_2;
+                break;
+            }
+            default:
+            {
+                // full resolution
+            }
+        }
+    }
+
+    // Decoding only reads the encoded bytes
+    const cv::Mat encodedImageView{1, static_cast<int>(size), CV_8UC1, const_cast<uchar*>(encodedImage)};
+
+    cv::Mat imageBGR;
+
+    if (jpegSize.has_value() && options_.framePool != nullptr)
+    {
+        const int height = (jpegSize->height + reductionFactor - 1) / reductionFactor;
+        const int width = (jpegSize->width + reductionFactor - 1) / reductionFactor;
+
+        frame = options_.framePool->Acquire(static_cast<size_t>(height) * width * 3);
+
+        if (frame)
+        {
+            imageBGR = cv::Mat{height, width, CV_8UC3, frame.getData()};
+        }
+    }
+
+    // Decodes into the pooled frame if its size matches, otherwise (e.g. rotated by the EXIF orientation) the decoder allocates
+    {
+        // The codecs allocate their decoder state on every call
+        ScopedExemptAllocations exemptAllocations;
+
+        cv::imdecode(encodedImageView, imreadMode, &imageBGR);
+    }
+
+    if (frame && imageBGR.data != frame.getData())
+    {
+        frame.reset();
+    }
+
+    return imageBGR;
+}
+
+Image StillImageSource::LoadImageFile(const std::filesystem::path& imagePath) const
+{
+    const auto decodeStartTime = std::chrono::steady_clock::now();
+
+    // Decode threads load images concurrently, each reads into a buffer of its own that only ever grows
+    thread_local std::vector<uchar> encodedImage;
+
+    const size_t size = ReadFile(imagePath, encodedImage);
+
+    FrameHandle frame;
+
+    cv::Mat imageBGR = DecodeImage(encodedImage.data(), size, frame);
+
+    if (imageBGR.empty())
+    {
+        std::cerr << "Could not decode image: " << imagePath.native() << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::error_code errorCode;
+    const auto modificationTime = std::filesystem::last_write_time(imagePath, errorCode);
+
+    Image img{imageBGR, imageBGR.rows, imageBGR.cols, ColorFormat::BGR, MemoryLayout::HWC, imagePath.native(), 0,
+              errorCode ? 0 : static_cast<int64_t>(modificationTime.time_since_epoch().count()), size};
+
+    img.frame = std::move(frame);
+    img.trace.decodeStart = decodeStartTime;
+    img.trace.decodeEnd = std::chrono::steady_clock::now();
+
+    return img;
+}
+
+Image StillImageSource::LoadPackedImage(size_t entryIdx) const
+{
+    const auto decodeStartTime = std::chrono::steady_clock::now();
+
+    const PackedDataset& packedDataset = *options_.packedDataset;
+    const PackEntry& entry = packedDataset.getEntry(entryIdx);
+    const uint8_t* const data = packedDataset.getData(entryIdx);
+
+    FrameHandle frame;
+    cv::Mat imageBGR;
+
+    if (packedDataset.getPayload() == PackPayload::RawBGR)
+    {
+        // Zero-copy view of the mapped frame, the preprocessing never writes into its source pixels
+        imageBGR = cv::Mat{static_cast<int>(entry.height), static_cast<int>(entry.width), CV_8UC3, const_cast<uint8_t*>(data)};
+    }
+    else
+    {
+        imageBGR = DecodeImage(data, entry.size, frame);
+    }
+
+    if (imageBGR.empty())
+    {
+        std::cerr << "Could not decode image: " << packedDataset.getName(entryIdx) << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    Image img{imageBGR, imageBGR.rows, imageBGR.cols, ColorFormat::BGR, MemoryLayout::HWC, packedDataset.getName(entryIdx), 0,
+              entry.modificationTime, entry.size};
+
+    img.frame = std::move(frame);
+    img.trace.decodeStart = decodeStartTime;
+    img.trace.decodeEnd = std::chrono::steady_clock::now();
+
+    return img;
+}
+
+Image StillImageSource::LoadImage(const ImageRequest& request) const
+{
+    Image img = (request.imagePath != nullptr) ? LoadImageFile(*request.imagePath) : LoadPackedImage(request.entryIdx);
+
+    decoded_.fetch_add(1, std::memory_order_relaxed);
+    decodeNanoseconds_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(img.trace.decodeEnd - img.trace.decodeStart).count(), std::memory_order_relaxed);
+
+    return img;
+}
+
+StillImageSource::ImageRequest StillImageSource::NextImageRequest()
+{
+    if (options_.packedDataset == nullptr)
+    {
+        const std::filesystem::path& imagePath = *imageIt_;
+        imageIt_++;
+
+        return ImageRequest{&imagePath, 0};
+    }
+
+    const PackedDataset& packedDataset = *options_.packedDataset;
+    const size_t entryIdx = packEntryIdx_;
+    packEntryIdx_ = (packEntryIdx_ + 1) % packedDataset.size();
+
+    // Page in the entry following the read-ahead window while the current ones are decoded
+    packedDataset.Prefetch((entryIdx + std::max<size_t>(options_.readAheadDepth, 1)) % packedDataset.size());
+
+    return ImageRequest{nullptr, entryIdx};
+}
+
+Image StillImageSource::NextFrame()
+{
+    if (decodePool_ == nullptr)
+    {
+        return LoadImage(NextImageRequest());
+    }
+
+    // Keep the decode pool busy with the upcoming images while the current one is handed out
+    const size_t readAheadDepth = std::max<size_t>(options_.readAheadDepth, 1);
+
+    while (pendingImages_.size() < readAheadDepth)
+    {
+        pendingImages_.push_back(decodePool_->Submit([this, request = NextImageRequest()]() { return LoadImage(request); }));
+    }
+
+    Image img = pendingImages_.front().get();
+    pendingImages_.pop_front();
+
+    return img;
+}
+
+FrameSourceStats StillImageSource::getStats() const
+{
+    return FrameSourceStats{decoded_.load(std::memory_order_relaxed), 0, decodeNanoseconds_.load(std::memory_order_relaxed) * 1e-9,
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - openTime_).count()};
+}
@@ -0,0 +1,114 @@
+#ifndef STILL_IMAGE_SOURCE_H_
+#define STILL_IMAGE_SOURCE_H_
+
+#include "frame_source.h"
+#include "image_provider.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ImageIterator
+{
+    public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::filesystem::path;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using difference_type = std::ptrdiff_t;
+
+    ImageIterator(std::vector<value_type>::const_iterator imageEntryIt
+    , std::vector<value_type>::const_iterator imageEntryItBegin
+    , std::vector<value_type>::const_iterator imageEntryItEnd) : 
+    imageEntryIt_{imageEntryIt},  imageEntryItBegin_{imageEntryItBegin}, imageEntryItEnd_{imageEntryItEnd}{}
+    reference operator*() const { return *imageEntryIt_; }
+    pointer operator->() const { return &(*imageEntryIt_); }
+    ImageIterator& operator++()
+    {
+        ++imageEntryIt_;
+        if (imageEntryIt_ == imageEntryItEnd_)
+        {
+            imageEntryIt_ = imageEntryItBegin_;
+        }
+
+        return *this;
+    }
+    ImageIterator operator++(int) { ImageIterator tempIt{*this}; operator++(); return tempIt; }
+
+    friend bool operator==(const ImageIterator& it1, const ImageIterator& it2) { return (it1.imageEntryIt_ == it2.imageEntryIt_); }
+    friend bool operator!=(const ImageIterator& it1, const ImageIterator& it2) { return !(it1.imageEntryIt_ == it2.imageEntryIt_); }
+
+    private:
+    std::vector<value_type>::const_iterator imageEntryIt_;
+    std::vector<value_type>::const_iterator imageEntryItBegin_;
+    std::vector<value_type>::const_iterator imageEntryItEnd_;
+};
+
+// Cycles through the images of a directory or a packed dataset, optionally decoding them ahead on a thread pool
+class StillImageSource final : public FrameSource
+{
+    public:
+    explicit StillImageSource(const ImageProviderOptions& options) : options_{options},
+        imageEntries_{(options.packedDataset == nullptr) ? populateImageEntries(options.imagesPath) : std::vector<std::filesystem::path>{}},
+        imageIt_{imageEntries_.cbegin(), imageEntries_.cbegin(), imageEntries_.cend()},
+        decodePool_{(options.decodeThreads > 0) ? std::make_unique<ThreadPool>(options.decodeThreads) : nullptr} {}
+    Image NextFrame() override;
+    FrameSourceStats getStats() const override;
+
+    private:
+    // Source of an image, either an entry of the images directory or of the packed dataset
+    struct ImageRequest
+    {
+        const std::filesystem::path* imagePath;
+        size_t entryIdx;
+    };
+
+    cv::Mat DecodeImage(const uchar* encodedImage, size_t size, FrameHandle& frame) const;
+    Image LoadImageFile(const std::filesystem::path& imagePath) const;
+    Image LoadPackedImage(size_t entryIdx) const;
+    Image LoadImage(const ImageRequest& request) const;
+    // Returns the source of the next image in capture order and advances to the following one
+    ImageRequest NextImageRequest();
+    static std::vector<std::filesystem::path> populateImageEntries(const std::string& imagesPath)
+    {
+        std::vector<std::filesystem::path> imageEntries;
+
+        for (const auto& imageEntry : std::filesystem::directory_iterator{imagesPath})
+        {
+            imageEntries.push_back(imageEntry.path());
+        }
+
+        if (imageEntries.empty())
+        {
+            std::cerr << "No images found in: " << imagesPath << std::endl;
+
+            std::exit(EXIT_FAILURE);
+        }
+
+        return imageEntries;
+    }
+
+    ImageProviderOptions options_;
+    std::vector<std::filesystem::path> imageEntries_;
+    ImageIterator imageIt_;
+    size_t packEntryIdx_{0};
+    // Images being decoded ahead, in capture order
+    std::deque<std::future<Image>> pendingImages_;
+    const std::chrono::steady_clock::time_point openTime_{std::chrono::steady_clock::now()};
+    // Updated by the decode threads
+    mutable std::atomic<uint64_t> decoded_{0};
+    mutable std::atomic<uint64_t> decodeNanoseconds_{0};
+    // Declared last so it is destroyed first, joining the decode threads before the members they use are gone
+    std::unique_ptr<ThreadPool> decodePool_;
+};
+
+#endif // #ifndef STILL_IMAGE_SOURCE_H_
@@ -0,0 +1,100 @@
+#include "tensor_cache.h"
+#include "hash.h"
+#include <algorithm>
+#include <iterator>
+
+uint64_t TensorCache::HashKey(const TensorCacheKey& key)
+{
+    uint64_t hash = Fnv1aHash(key.path);
+    hash = Fnv1aHashValue(key.modificationTime, hash);
+    hash = Fnv1aHashValue(key.fileSize, hash);
+    hash = Fnv1aHashValue(key.height, hash);
+    hash = Fnv1aHashValue(key.width, hash);
+
+    return Fnv1aHashValue(key.preprocessSignature, hash);
+}
+
+bool TensorCache::Matches(const Entry& entry, const TensorCacheKey& key)
+{
+    return entry.path == key.path && entry.modificationTime == key.modificationTime && entry.fileSize == key.fileSize &&
+           entry.height == key.height && entry.width == key.width && entry.preprocessSignature == key.preprocessSignature;
+}
+
+bool TensorCache::Lookup(const TensorCacheKey& key, float* tensor, size_t tensorSize)
+{
+    const uint64_t keyHash = HashKey(key);
+
+    std::shared_ptr<const std::vector<float>> cachedTensor;
+
+    {
+        std::lock_guard<std::mutex> lgCache{mtxCache_};
+
+        auto indexIt = entryIndex_.find(keyHash);
+
+        if (indexIt == entryIndex_.end() || !Matches(*indexIt->second, key) || indexIt->second->tensor->size() != tensorSize)
+        {
+            misses_++;
+
+            return false;
+        }
+
+        hits_++;
+
+        // Move to the front of the LRU list
+        entries_.splice(entries_.begin(), entries_, indexIt->second);
+
+        cachedTensor = indexIt->second->tensor;
+    }
+
+    // Copy outside of the lock, the shared pointer keeps the tensor alive even if it gets evicted meanwhile
+    std::copy_n(cachedTensor->data(), tensorSize, tensor);
+
+    return true;
+}
+
+void TensorCache::Insert(const TensorCacheKey& key, const float* tensor, size_t tensorSize)
+{
+    Entry entry{HashKey(key), std::string{key.path}, key.modificationTime, key.fileSize, key.height, key.width, key.preprocessSignature,
+                std::make_shared<const std::vector<float>>(tensor, tensor + tensorSize)};
+
+    const size_t entryBytes = EntryBytes(entry);
+
+    if (entryBytes > budgetBytes_)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lgCache{mtxCache_};
+
+    auto indexIt = entryIndex_.find(entry.keyHash);
+
+    if (indexIt != entryIndex_.end())
+    {
+        // Outdated file version or hash collision
+        Erase(indexIt->second);
+    }
+
+    while (bytes_ + entryBytes > budgetBytes_ && !entries_.empty())
+    {
+        Erase(std::prev(entries_.end()));
+        evictions_++;
+    }
+
+    entries_.push_front(std::move(entry));
+    entryIndex_.emplace(entries_.front().keyHash, entries_.begin());
+    bytes_ += entryBytes;
+}
+
+void TensorCache::Erase(std::list<Entry>::iterator entryIt)
+{
+    bytes_ -= EntryBytes(*entryIt);
+    entryIndex_.erase(entryIt->keyHash);
+    entries_.erase(entryIt);
+}
+
+TensorCacheStats TensorCache::getStats() const
+{
+    std::lock_guard<std::mutex> lgCache{mtxCache_};
+
+    return TensorCacheStats{hits_, misses_, evictions_, entries_.size(), bytes_, budgetBytes_};
+}
@@ -0,0 +1,77 @@
+#ifndef TENSOR_CACHE_H_
+#define TENSOR_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Identifies the preprocessed tensor of an image file: the file version and the exact preprocessing applied
+struct TensorCacheKey
+{
+    std::string_view path;
+    int64_t modificationTime;
+    uintmax_t fileSize;
+    // Decoded image size, differs from the file's frame size for reduced resolution decoding
+    int height;
+    int width;
+    uint64_t preprocessSignature;
+};
+
+struct TensorCacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t bytes;
+    size_t budgetBytes;
+};
+
+// LRU cache of preprocessed input tensors, bounded by a memory budget and shared by all workers
+class TensorCache
+{
+    public:
+    explicit TensorCache(size_t budgetBytes) : budgetBytes_{budgetBytes} {}
+    TensorCache(const TensorCache& other) = delete;
+    TensorCache& operator=(const TensorCache& other) = delete;
+    // Copies the cached tensor to the destination on a hit
+    bool Lookup(const TensorCacheKey& key, float* tensor, size_t tensorSize);
+    void Insert(const TensorCacheKey& key, const float* tensor, size_t tensorSize);
+    TensorCacheStats getStats() const;
+
+    private:
+    struct Entry
+    {
+        uint64_t keyHash;
+        std::string path;
+        int64_t modificationTime;
+        uintmax_t fileSize;
+        int height;
+        int width;
+        uint64_t preprocessSignature;
+        std::shared_ptr<const std::vector<float>> tensor;
+    };
+
+    static uint64_t HashKey(const TensorCacheKey& key);
+    static bool Matches(const Entry& entry, const TensorCacheKey& key);
+    static size_t EntryBytes(const Entry& entry) { return entry.tensor->size() * sizeof(float) + entry.path.size() + sizeof(Entry); }
+    void Erase(std::list<Entry>::iterator entryIt);
+
+    const size_t budgetBytes_;
+    mutable std::mutex mtxCache_;
+    // Most recently used entry first
+    std::list<Entry> entries_;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> entryIndex_;
+    size_t bytes_{0};
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t evictions_{0};
+};
+
+#endif // #ifndef TENSOR_CACHE_H_
@@ -0,0 +1,158 @@
+#include "thread_placement.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <thread>
+#include <pthread.h>
+
+static std::optional<int> ParseCpu(const std::string& value)
+{
+    char* end = nullptr;
+    const long cpu = std::strtol(value.c_str(), &end, 10);
+
+    if (value.empty() || *end != '\0' || cpu < 0 || cpu >= CPU_SETSIZE)
+    {
+        return std::nullopt;
+    }
+
+    return static_cast<int>(cpu);
+}
+
+static std::optional<CpuList> ParseKernelCpuList(const std::string& value)
+{
+    CpuList cpus;
+
+    for (size_t rangeStart = 0; rangeStart <= value.size();)
+    {
+        size_t rangeEnd = value.find(',', rangeStart);
+
+        if (rangeEnd == std::string::npos)
+        {
+            rangeEnd = value.size();
+        }
+
+        const std::string range = value.substr(rangeStart, rangeEnd - rangeStart);
+        const size_t dashPos = range.find('-');
+
+        std::optional<int> firstCpu = ParseCpu(range.substr(0, dashPos));
+        std::optional<int> lastCpu = (dashPos == std::string::npos) ? firstCpu : ParseCpu(range.substr(dashPos + 1));
+
+        if (!firstCpu.has_value() || !lastCpu.has_value() || *lastCpu < *firstCpu)
+        {
+            return std::nullopt;
+        }
+
+        for (int cpu = *firstCpu; cpu <= *lastCpu; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+
+        rangeStart = rangeEnd + 1;
+    }
+
+    return cpus;
+}
+
+std::optional<CpuList> ParseCpuList(const std::string& value)
+{
+    const std::string nodePrefix{"node:"};
+
+    if (value.compare(0, nodePrefix.size(), nodePrefix) != 0)
+    {
+        return ParseKernelCpuList(value);
+    }
+
+    const std::string node = value.substr(nodePrefix.size());
+
+    if (!ParseCpu(node).has_value())
+    {
+        return std::nullopt;
+    }
+
+    std::ifstream ifstrm{"/sys/devices/system/node/node" + node + "/cpulist"};
+    std::string nodeCpuList;
+
+    // Nodes without CPUs (memory only) have an empty list
+    if (!std::getline(ifstrm, nodeCpuList) || nodeCpuList.empty())
+    {
+        return std::nullopt;
+    }
+
+    return ParseKernelCpuList(nodeCpuList);
+}
+
+const CpuList& SelectCpuList(const std::vector<CpuList>& workerCpuLists, size_t workerIdx)
+{
+    static const CpuList kUnpinned;
+
+    return workerCpuLists.empty() ? kUnpinned : workerCpuLists[workerIdx % workerCpuLists.size()];
+}
+
+bool PinCurrentThread(const CpuList& cpus)
+{
+    if (cpus.empty())
+    {
+        return true;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+
+    for (const int cpu : cpus)
+    {
+        CPU_SET(cpu, &cpuSet);
+    }
+
+    if (::pthread_setaffinity_np(::pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+    {
+        std::cerr << "Could not pin thread to CPUs " << cpus.front() << "-" << cpus.back() << ", CPUs offline or not permitted" << std::endl;
+
+        return false;
+    }
+
+    return true;
+}
+
+ScopedThreadPlacement::ScopedThreadPlacement(const CpuList& cpus)
+{
+    CPU_ZERO(&previousCpus_);
+
+    if (!cpus.empty() && ::pthread_getaffinity_np(::pthread_self(), sizeof(previousCpus_), &previousCpus_) == 0)
+    {
+        pinned_ = PinCurrentThread(cpus);
+    }
+}
+
+ScopedThreadPlacement::~ScopedThreadPlacement()
+{
+    if (pinned_)
+    {
+        (void)::pthread_setaffinity_np(::pthread_self(), sizeof(previousCpus_), &previousCpus_);
+    }
+}
+
+OrtCustomThreadHandle OrtThreadPlacement::CreateThread(void* placement, OrtThreadWorkerFn workerFn, void* workerParam)
+{
+    OrtThreadPlacement& threadPlacement = *static_cast<OrtThreadPlacement*>(placement);
+
+    const int cpu = threadPlacement.cpus_[threadPlacement.nextCpuIdx_.fetch_add(1) % threadPlacement.cpus_.size()];
+
+    // Pinned before the worker function runs, so that the thread-local buffers of ONNX Runtime are first touched on its node
+    auto* thread = new std::thread{[cpu, workerFn, workerParam]()
+    {
+        (void)PinCurrentThread(CpuList{cpu});
+
+        workerFn(workerParam);
+    }};
+
+    return reinterpret_cast<OrtCustomThreadHandle>(thread);
+}
+
+void OrtThreadPlacement::JoinThread(OrtCustomThreadHandle threadHandle)
+{
+    auto* thread = reinterpret_cast<std::thread*>(const_cast<OrtCustomHandleType*>(threadHandle));
+
+    thread->join();
+
+    delete thread;
+}
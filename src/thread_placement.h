@@ -0,0 +1,58 @@
+#ifndef THREAD_PLACEMENT_H_
+#define THREAD_PLACEMENT_H_
+
+#include <onnxruntime_cxx_api.h>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+#include <sched.h>
+
+// CPUs a thread may run on, an empty list leaves the placement to the scheduler
+using CpuList = std::vector<int>;
+
+// Parses a cpulist as used by the kernel ("0-3,8,10-11") or "node:N" for the CPUs of NUMA node N.
+// Nothing if the list is malformed or the node does not exist.
+std::optional<CpuList> ParseCpuList(const std::string& value);
+
+// List of the given worker if one list per worker is configured, workers beyond the configured lists start over at the first one
+const CpuList& SelectCpuList(const std::vector<CpuList>& workerCpuLists, size_t workerIdx);
+
+// Restricts the calling thread to the CPUs, an empty list leaves its affinity unchanged
+bool PinCurrentThread(const CpuList& cpus);
+
+// Pins the calling thread until the end of the scope. Threads started meanwhile inherit the affinity, and memory first touched
+// meanwhile is placed on the NUMA node of the CPUs by the kernel's first-touch policy, which makes this the place to create
+// the threads of a stage and the buffers they work on.
+class ScopedThreadPlacement
+{
+    public:
+    explicit ScopedThreadPlacement(const CpuList& cpus);
+    ScopedThreadPlacement(const ScopedThreadPlacement& other) = delete;
+    ScopedThreadPlacement& operator=(const ScopedThreadPlacement& other) = delete;
+    ~ScopedThreadPlacement();
+
+    private:
+    cpu_set_t previousCpus_;
+    bool pinned_{false};
+};
+
+// Thread creation hooks for the thread pools of ONNX Runtime, which pin every pool thread to a CPU of its own, taking the
+// CPUs of the list in turn. The placement is passed as the thread creation options, hence it has to outlive the pools.
+class OrtThreadPlacement
+{
+    public:
+    explicit OrtThreadPlacement(CpuList cpus) : cpus_{std::move(cpus)} {}
+    OrtThreadPlacement(const OrtThreadPlacement& other) = delete;
+    OrtThreadPlacement& operator=(const OrtThreadPlacement& other) = delete;
+    bool empty() const noexcept { return cpus_.empty(); }
+    static OrtCustomThreadHandle CreateThread(void* placement, OrtThreadWorkerFn workerFn, void* workerParam);
+    static void JoinThread(OrtCustomThreadHandle threadHandle);
+
+    private:
+    CpuList cpus_;
+    std::atomic<size_t> nextCpuIdx_{0};
+};
+
+#endif // #ifndef THREAD_PLACEMENT_H_
@@ -0,0 +1,93 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed set of threads executing submitted tasks in submission order
+class ThreadPool
+{
+    public:
+    explicit ThreadPool(size_t nrOfThreads)
+    {
+        for (size_t threadIdx = 0; threadIdx < nrOfThreads; threadIdx++)
+        {
+            threads_.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+    // Finishes all submitted tasks before joining the threads
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lgTasks{mtxTasks_};
+            stopped_ = true;
+        }
+
+        cvTaskAvailable_.notify_all();
+
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    template <typename Task>
+    auto Submit(Task&& task) -> std::future<decltype(task())>
+    {
+        auto packagedTask = std::make_shared<std::packaged_task<decltype(task())()>>(std::forward<Task>(task));
+        auto future = packagedTask->get_future();
+
+        {
+            std::lock_guard<std::mutex> lgTasks{mtxTasks_};
+            tasks_.emplace([packagedTask]() { (*packagedTask)(); });
+        }
+
+        cvTaskAvailable_.notify_one();
+
+        return future;
+    }
+
+    private:
+    void WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> ulTasks{mtxTasks_};
+                cvTaskAvailable_.wait(ulTasks, [&]()
+                {
+                    return !tasks_.empty() || stopped_;
+                });
+
+                if (tasks_.empty())
+                {
+                    return;
+                }
+
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+
+            task();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mtxTasks_;
+    std::condition_variable cvTaskAvailable_;
+    bool stopped_{false};
+};
+
+#endif // #ifndef THREAD_POOL_H_
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "video_file_source.h"
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+
+VideoFileSource::VideoFileSource(const ImageProviderOptions& options) : options_{options},
+    decodedFrames_{std::max<size_t>(options.readAheadDepth, 2), OverflowPolicy::DropOldest}
+{
+    if (!capture_.open(options_.videoPath))
+    {
+        std::cerr << "Could not open video: " << options_.videoPath << std::endl;
+
+        std::exit(EXIT_FAILURE);
+    }
+
+    frameHeight_ = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT));
+    frameWidth_ = static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH));
+
+    const double framesPerSecond = capture_.get(cv::CAP_PROP_FPS);
+
+    if (framesPerSecond > 0.0)
+    {
+        frameInterval_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{1.0 / framesPerSecond});
+    }
+
+    decodeThread_ = std::thread{&VideoFileSource::DecodeLoop, this};
+}
+
+VideoFileSource::~VideoFileSource()
+{
+    stopped_.store(true, std::memory_order_release);
+
+    // Wakes up the decode thread if it is about to push, remaining frames are released with the buffer
+    decodedFrames_.close();
+
+    decodeThread_.join();
+}
+
+bool VideoFileSource::DecodeFrame(Image& img)
+{
+    const auto decodeStartTime = std::chrono::steady_clock::now();
+
+    FrameHandle frame;
+    cv::Mat frameBGR;
+
+    if (options_.framePool != nullptr && frameHeight_ > 0 && frameWidth_ > 0)
+    {
+        frame = options_.framePool->Acquire(static_cast<size_t>(frameHeight_) * frameWidth_ * 3);
+
+        if (frame)
+        {
+            frameBGR = cv::Mat{frameHeight_, frameWidth_, CV_8UC3, frame.getData()};
+        }
+    }
+
+    // The decoder writes into the pooled frame if the size matches the one reported by the stream
+    if (!capture_.read(frameBGR) || frameBGR.empty())
+    {
+        return false;
+    }
+
+    if (frame && frameBGR.data != frame.getData())
+    {
+        frame.reset();
+    }
+
+    img = Image{frameBGR, frameBGR.rows, frameBGR.cols, ColorFormat::BGR, MemoryLayout::HWC, options_.videoPath};
+
+    img.frame = std::move(frame);
+    img.trace.decodeStart = decodeStartTime;
+    img.trace.decodeEnd = std::chrono::steady_clock::now();
+
+    decoded_.fetch_add(1, std::memory_order_relaxed);
+    decodeNanoseconds_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(img.trace.decodeEnd - decodeStartTime).count(), std::memory_order_relaxed);
+
+    return true;
+}
+
+void VideoFileSource::DecodeLoop()
+{
+    auto nextFrameTime = std::chrono::steady_clock::now();
+
+    while (!stopped_.load(std::memory_order_acquire))
+    {
+        Image img;
+
+        if (!DecodeFrame(img))
+        {
+            // End of the stream, start over
+            capture_.set(cv::CAP_PROP_POS_FRAMES, 0);
+
+            if (!DecodeFrame(img))
+            {
+                failed_.store(true, std::memory_order_release);
+                decodedFrames_.close();
+
+                return;
+            }
+        }
+
+        // Every frame evicted to make room counts, the frame itself only comes back once the source was stopped
+        (void)decodedFrames_.push(std::move(img), [this](Image&&)
+        {
+            if (!stopped_.load(std::memory_order_acquire))
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        if (frameInterval_.count() > 0)
+        {
+            // After falling behind by more than a frame, the stream continues from now instead of catching up in a burst
+            nextFrameTime = std::max(nextFrameTime + frameInterval_, std::chrono::steady_clock::now() - frameInterval_);
+
+            std::this_thread::sleep_until(nextFrameTime);
+        }
+    }
+}
+
+Image VideoFileSource::NextFrame()
+{
+    Image img;
+
+    while (decodedFrames_.pop(img))
+    {
+        const auto frameAge = std::chrono::steady_clock::now() - img.trace.decodeEnd;
+
+        if (options_.maxFrameAge.count() == 0 || frameAge <= options_.maxFrameAge)
+        {
+            break;
+        }
+
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return img;
+}
+
+std::string VideoFileSource::getError() const
+{
+    return failed_.load(std::memory_order_acquire) ? "Could not decode video: " + options_.videoPath : std::string{};
+}
+
+FrameSourceStats VideoFileSource::getStats() const
+{
+    return FrameSourceStats{decoded_.load(std::memory_order_relaxed), dropped_.load(std::memory_order_relaxed),
+                            decodeNanoseconds_.load(std::memory_order_relaxed) * 1e-9,
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - openTime_).count()};
+}
@@ -0,0 +1,50 @@
+#ifndef VIDEO_FILE_SOURCE_H_
+#define VIDEO_FILE_SOURCE_H_
+
+#include "frame_source.h"
+#include "image_provider.h"
+#include "bounded_queue.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// Streams a video file like a live feed: frames are decoded on a thread of its own, paced at the frame rate
+// of the stream, and the file is looped at its end. Decoded frames wait in a small buffer, which drops the
+// oldest frame when the consumer falls behind. Frames that exceed the freshness budget by the time they are
+// requested are skipped in favor of newer ones.
+class VideoFileSource final : public FrameSource
+{
+    public:
+    explicit VideoFileSource(const ImageProviderOptions& options);
+    VideoFileSource(const VideoFileSource& other) = delete;
+    VideoFileSource& operator=(const VideoFileSource& other) = delete;
+    ~VideoFileSource() override;
+    Image NextFrame() override;
+    FrameSourceStats getStats() const override;
+    std::string getError() const override;
+
+    private:
+    void DecodeLoop();
+    bool DecodeFrame(Image& img);
+
+    ImageProviderOptions options_;
+    cv::VideoCapture capture_;
+    int frameHeight_{0};
+    int frameWidth_{0};
+    // Zero if the stream does not report its frame rate, frames are decoded as fast as possible then
+    std::chrono::steady_clock::duration frameInterval_{0};
+    BoundedQueue<Image> decodedFrames_;
+    std::atomic<bool> stopped_{false};
+    // Set by the decode thread before it closes the buffer, the owner shuts down once the buffered frames are consumed
+    std::atomic<bool> failed_{false};
+    const std::chrono::steady_clock::time_point openTime_{std::chrono::steady_clock::now()};
+    std::atomic<uint64_t> decoded_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> decodeNanoseconds_{0};
+    // Started once all other members are initialized
+    std::thread decodeThread_;
+};
+
+#endif // #ifndef VIDEO_FILE_SOURCE_H_
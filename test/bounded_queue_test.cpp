@@ -0,0 +1,90 @@
+#include "bounded_queue.h"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Several producers push sequence numbers into a small DropOldest queue drained by one slow consumer. Every sequence
+// number has to come out exactly once, either popped by the consumer or handed back to a producer as dropped.
+
+constexpr size_t kNrOfProducers{4};
+constexpr uint64_t kValuesPerProducer{20000};
+constexpr size_t kQueueCapacity{4};
+
+static bool RunDropOldestCase()
+{
+    BoundedQueue<uint64_t> queue{kQueueCapacity, OverflowPolicy::DropOldest};
+
+    std::vector<uint32_t> seen(kNrOfProducers * kValuesPerProducer, 0);
+    std::mutex mtxSeen;
+    std::atomic<uint64_t> nrOfDropped{0};
+
+    auto markSeen = [&](uint64_t value)
+    {
+        std::lock_guard<std::mutex> lgSeen{mtxSeen};
+        seen[value]++;
+    };
+
+    std::thread consumer{[&]()
+    {
+        uint64_t value;
+
+        while (queue.pop(value))
+        {
+            markSeen(value);
+
+            // Slow enough for the queue to overflow most of the time
+            std::this_thread::sleep_for(std::chrono::microseconds{20});
+        }
+    }};
+
+    std::vector<std::thread> producers;
+
+    for (size_t producerIdx = 0; producerIdx < kNrOfProducers; producerIdx++)
+    {
+        producers.emplace_back([&, producerIdx]()
+        {
+            for (uint64_t valueIdx = 0; valueIdx < kValuesPerProducer; valueIdx++)
+            {
+                (void)queue.push(producerIdx * kValuesPerProducer + valueIdx, [&](uint64_t&& dropped)
+                {
+                    nrOfDropped.fetch_add(1, std::memory_order_relaxed);
+                    markSeen(dropped);
+                });
+            }
+        });
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    queue.close();
+    consumer.join();
+
+    size_t nrOfLost = 0;
+    size_t nrOfDuplicates = 0;
+
+    for (uint32_t count : seen)
+    {
+        nrOfLost += (count == 0) ? 1 : 0;
+        nrOfDuplicates += (count > 1) ? 1 : 0;
+    }
+
+    const bool passed = (nrOfLost == 0 && nrOfDuplicates == 0 && queue.getStats().dropped == nrOfDropped.load());
+
+    std::cout << (passed ? "PASS " : "FAIL ") << "drop oldest with " << kNrOfProducers << " producers: dropped " << nrOfDropped.load()
+              << ", lost " << nrOfLost << ", duplicated " << nrOfDuplicates << "\n";
+
+    return passed;
+}
+
+int main()
+{
+    return RunDropOldestCase() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
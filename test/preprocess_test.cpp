@@ -0,0 +1,182 @@
+#include "image_preprocessor.h"
+#include "fused_preprocessor.h"
+#include "model_handler.h"
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// Checks the fused preprocessing kernel and its compile-time specialization against the reference transformation chain on
+// synthetic frames covering padding, identity, integer and non-integer shrinking, and widths that are not a multiple of the SIMD width.
+
+// The fused kernel rounds resampled pixels like the reference resize, so outputs may differ by one 8 bit level at most
+constexpr float kMaxPreprocessDeviation{0.02f};
+
+struct PreprocessCase
+{
+    const char* name;
+    int srcHeight;
+    int srcWidth;
+    int dstHeight;
+    int dstWidth;
+};
+
+constexpr std::array<PreprocessCase, 11> kPreprocessCases
+{
+    PreprocessCase{"identity", 224, 224, 224, 224},
+    PreprocessCase{"pad", 160, 160, 224, 224},
+    PreprocessCase{"pad height", 100, 224, 224, 224},
+    PreprocessCase{"pad odd width", 201, 223, 224, 224},
+    PreprocessCase{"integer shrink", 448, 448, 224, 224},
+    PreprocessCase{"integer shrink per dimension", 672, 448, 224, 224},
+    PreprocessCase{"non-integer shrink", 375, 500, 224, 224},
+    PreprocessCase{"non-integer shrink odd width", 301, 451, 224, 224},
+    PreprocessCase{"shrink to odd width", 500, 375, 227, 223},
+    PreprocessCase{"pad to odd width", 100, 101, 227, 223},
+    PreprocessCase{"identity odd width", 227, 223, 227, 223}
+};
+
+static Image MakeSyntheticFrame(int height, int width)
+{
+    Image img{};
+    img.matrix = cv::Mat(height, width, CV_8UC3);
+    cv::randu(img.matrix, cv::Scalar::all(0), cv::Scalar::all(256));
+    img.height = height;
+    img.width = width;
+    img.fmt = ColorFormat::BGR;
+    img.layout = MemoryLayout::HWC;
+
+    return img;
+}
+
+static std::unique_ptr<ImagePreprocessingPipeline> BuildReferencePipeline(int height, int width)
+{
+    ImagePreprocessingPipelineBuilder builder;
+    builder.addResize(height, width);
+    builder.addConvertColor(ColorFormat::RGB);
+    builder.addNormalize(MobileNetV2Descriptor::kChannelNormParams);
+    builder.addConvertMemLayout(MemoryLayout::CHW);
+
+    return builder.build();
+}
+
+static bool RunCase(const char* kernelName, TensorPreprocessor& fusedPreprocessor, const PreprocessCase& preprocessCase)
+{
+    const Image frame = MakeSyntheticFrame(preprocessCase.srcHeight, preprocessCase.srcWidth);
+
+    std::vector<float> fusedTensor(static_cast<size_t>(preprocessCase.dstHeight) * preprocessCase.dstWidth * 3);
+
+    if (!fusedPreprocessor.apply(frame, fusedTensor.data()))
+    {
+        std::cout << "FAIL " << kernelName << " " << preprocessCase.name << ": kernel not applicable\n";
+
+        return false;
+    }
+
+    Image referenceImg = frame.Borrow();
+    BuildReferencePipeline(preprocessCase.dstHeight, preprocessCase.dstWidth)->apply(referenceImg);
+
+    if (referenceImg.matrix.total() != fusedTensor.size())
+    {
+        std::cout << "FAIL " << kernelName << " " << preprocessCase.name << ": reference tensor holds " << referenceImg.matrix.total() << " values, expected " << fusedTensor.size() << "\n";
+
+        return false;
+    }
+
+    const float* referenceTensor = referenceImg.matrix.ptr<float>();
+
+    float maxDeviation = 0.0f;
+
+    for (size_t valueIdx = 0; valueIdx < fusedTensor.size(); valueIdx++)
+    {
+        maxDeviation = std::max(maxDeviation, std::abs(fusedTensor[valueIdx] - referenceTensor[valueIdx]));
+    }
+
+    const bool passed = (maxDeviation <= kMaxPreprocessDeviation);
+
+    std::cout << (passed ? "PASS " : "FAIL ") << kernelName << " " << preprocessCase.name << " " << preprocessCase.srcHeight << "x" << preprocessCase.srcWidth << " -> "
+              << preprocessCase.dstHeight << "x" << preprocessCase.dstWidth << ": max deviation " << maxDeviation << "\n";
+
+    return passed;
+}
+
+// The staged static pipeline is the fallback of the static kernel, including frames the kernel does not handle
+static bool RunStagedCase(const char* caseName, int srcHeight, int srcWidth)
+{
+    const Image frame = MakeSyntheticFrame(srcHeight, srcWidth);
+
+    const StaticPipelineTransformation<StaticClassificationPipeline<MobileNetV2Descriptor>> stagedTransformation;
+
+    Image stagedImg = frame.Borrow();
+    stagedTransformation.apply(stagedImg);
+
+    Image referenceImg = frame.Borrow();
+    BuildReferencePipeline(MobileNetV2Descriptor::kInputHeight, MobileNetV2Descriptor::kInputWidth)->apply(referenceImg);
+
+    float maxDeviation = std::numeric_limits<float>::infinity();
+
+    if (stagedImg.matrix.total() == referenceImg.matrix.total() && stagedImg.matrix.type() == CV_32F && stagedImg.layout == MemoryLayout::CHW)
+    {
+        maxDeviation = 0.0f;
+
+        for (size_t valueIdx = 0; valueIdx < referenceImg.matrix.total(); valueIdx++)
+        {
+            maxDeviation = std::max(maxDeviation, std::abs(stagedImg.matrix.ptr<float>()[valueIdx] - referenceImg.matrix.ptr<float>()[valueIdx]));
+        }
+    }
+
+    const bool passed = (maxDeviation <= kMaxPreprocessDeviation);
+
+    std::cout << (passed ? "PASS " : "FAIL ") << "static staged " << caseName << " " << srcHeight << "x" << srcWidth << ": max deviation " << maxDeviation << "\n";
+
+    return passed;
+}
+
+// Frames larger than the input in one dimension and smaller in the other are left to the transformation chain
+static bool RunMixedDimensionsCase()
+{
+    const Image frame = MakeSyntheticFrame(100, 640);
+
+    FusedPreprocessor fusedPreprocessor{224, 224, MobileNetV2Descriptor::kChannelNormParams};
+
+    std::vector<float> fusedTensor(224 * 224 * 3);
+
+    Image referenceImg = frame.Borrow();
+    BuildReferencePipeline(224, 224)->apply(referenceImg);
+
+    const bool passed = !fusedPreprocessor.apply(frame, fusedTensor.data()) && referenceImg.matrix.total() == fusedTensor.size();
+
+    std::cout << (passed ? "PASS " : "FAIL ") << "mixed dimensions 100x640 -> 224x224\n";
+
+    return passed;
+}
+
+int main()
+{
+    bool passed = true;
+
+    for (const PreprocessCase& preprocessCase : kPreprocessCases)
+    {
+        FusedPreprocessor fusedPreprocessor{preprocessCase.dstHeight, preprocessCase.dstWidth, MobileNetV2Descriptor::kChannelNormParams};
+
+        passed = RunCase("fused", fusedPreprocessor, preprocessCase) && passed;
+
+        // The static kernel is specialized for the MobileNetV2 input size only
+        if (preprocessCase.dstHeight == MobileNetV2Descriptor::kInputHeight && preprocessCase.dstWidth == MobileNetV2Descriptor::kInputWidth)
+        {
+            StaticFusedClassification<MobileNetV2Descriptor> staticPreprocessor;
+
+            passed = RunCase("static", staticPreprocessor, preprocessCase) && passed;
+            passed = RunStagedCase(preprocessCase.name, preprocessCase.srcHeight, preprocessCase.srcWidth) && passed;
+        }
+    }
+
+    passed = RunMixedDimensionsCase() && passed;
+    passed = RunStagedCase("mixed dimensions", 100, 640) && passed;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,72 @@
+#include "reorder_buffer.h"
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <vector>
+
+// Values inserted out of order, with skipped sequence numbers and a ring that has to grow, come out in sequence.
+// Stale sequence numbers (already released) must neither be handed out again nor disturb later values.
+
+static bool Report(bool passed, const char* caseName)
+{
+    std::cout << (passed ? "PASS " : "FAIL ") << caseName << "\n";
+
+    return passed;
+}
+
+static bool RunOutOfOrderCase()
+{
+    ReorderBuffer<uint64_t> buffer{2};
+    std::vector<uint64_t> released;
+
+    auto consumer = [&released](uint64_t&& value) { released.push_back(value); };
+
+    // Sequence number 3 never carries a value, 6 arrives last and forces the ring to grow
+    for (uint64_t sequenceNr : {2, 1, 5, 4, 7, 0})
+    {
+        buffer.insert(sequenceNr, sequenceNr);
+        buffer.release(consumer);
+    }
+
+    buffer.insert(3, std::nullopt);
+    buffer.release(consumer);
+    buffer.insert(6, 6);
+    buffer.release(consumer);
+
+    return Report(released == std::vector<uint64_t>{0, 1, 2, 4, 5, 6, 7} && buffer.getNrOfStale() == 0, "out of order");
+}
+
+static bool RunStaleCase()
+{
+    ReorderBuffer<uint64_t> buffer{4};
+    std::vector<uint64_t> released;
+
+    auto consumer = [&released](uint64_t&& value) { released.push_back(value); };
+
+    for (uint64_t sequenceNr = 0; sequenceNr < 4; sequenceNr++)
+    {
+        buffer.insert(sequenceNr, sequenceNr);
+    }
+
+    buffer.release(consumer);
+
+    // 0 maps to the same ring entry as 4, which has not arrived yet
+    buffer.insert(0, 100);
+    buffer.insert(1, std::nullopt);
+    buffer.release(consumer);
+
+    buffer.insert(4, 4);
+    buffer.release(consumer);
+
+    return Report(released == std::vector<uint64_t>{0, 1, 2, 3, 4} && buffer.getNrOfStale() == 2, "stale sequence numbers");
+}
+
+int main()
+{
+    bool passed = RunOutOfOrderCase();
+
+    passed = RunStaleCase() && passed;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}